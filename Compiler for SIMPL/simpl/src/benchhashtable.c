@@ -0,0 +1,1036 @@
+/**
+ * @file    benchhashtable.c
+ * @brief   A driver program to measure the speed of the hash table unit on
+ *          workloads like those of the symbol table.
+ *
+ * Three workloads are measured.  The keys of the first two are symbols, as
+ * handed out by the interning pool, which are hashed and compared as in
+ * symboltable.c; the keys of the third are strings.
+ *
+ * - tables: tables of a given number of entries are filled with a random
+ *   subset of the symbols, and then searched for symbols that they hold (hits)
+ *   and symbols that they do not hold (misses); the longest single insertion
+ *   is reported too, since it shows what growing the table costs;
+ * - scopes: a global table is filled once, and then, for each of many
+ *   subroutines, a local table is filled, searched as <code>find_name</code>
+ *   searches it, falling back on the global table for a miss, and freed;
+ *   and
+ * - strings: tables are filled with string keys, either sequential names that
+ *   differ in their trailing digits or random identifiers, of short, medium,
+ *   and long lengths, and then searched by copies of the keys, once with most
+ *   of the searches hitting and once with most of them missing; this is done
+ *   for each hash function at the default load factor, and for the strong hash
+ *   function in bytehash.c at several load factors.
+ *
+ * All workloads run on <code>HashTab</code>, and then on a table generated
+ * from typedtable.h, whose calls can be inlined, and which hashes strings only
+ * with the function in bytehash.c.  The program is built once for each
+ * implementation of <code>HashTab</code>, so that the times can be compared.
+ * The random numbers come from a fixed seed, so each build sees the same
+ * operations.
+ *
+ * Each workload runs in a process of its own, and reports, besides its best
+ * time per operation, the number of allocations it made per insertion, or for
+ * scopes, per local table, and the peak resident set of its process.
+ * Allocations are counted only with the GNU C library, whose allocator this
+ * program wraps.
+ *
+ * With <code>--collisions</code>, the program instead measures how well some
+ * hash functions spread identifiers over the buckets of a chained table, both
+ * for prime sizes reduced by division and for power-of-two sizes reduced by
+ * masking.  The identifiers are those of the specified files, and a generated
+ * set of names that differ only in their trailing digits.  For each set, the
+ * table is as large as it grows to at a load factor of 0.75, and the cost of a
+ * successful search is reported against that of a uniformly random hash, so
+ * that 1.00 is ideal.
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "boolean.h"
+#include "bytehash.h"
+#include "error.h"
+#include "hashtable.h"
+#include "typedtable.h"
+
+/* --- type definitions and constants --------------------------------------- */
+
+#define NUM_RUNS          3
+#define NUM_LOOKUPS       4000000
+#define NUM_GLOBALS       1000
+#define NUM_SUBROUTINES   20000
+#define MAX_LOCALS        32
+#define LOOKUPS_PER_LOCAL 8
+
+#define NUM_STRING_KEYS    65536
+#define NUM_STRING_LOOKUPS 500000
+#define HIT_PERCENT        90
+
+#define NUM_GENERATED     10000
+#define MAX_IDENTIFIER    256
+#define LOADFACTOR        0.75
+
+/* the symbols of identifiers are stored in the hash table in place of keys */
+#define SYMBOL_KEY(sym) ((void *) (size_t) (sym))
+#define KEY_SYMBOL(key) ((unsigned int) (size_t) (key))
+
+/* the typed table hashes and compares the symbols directly */
+#define SYMBOL_HASH(sym)   (sym)
+#define SAME_SYMBOL(a, b)  ((a) == (b))
+
+DEFINE_TYPED_TABLE(SymTab, symtab, unsigned int, void *, SYMBOL_HASH,
+		SAME_SYMBOL)
+
+/* and it hashes strings as the interning pool would */
+#define SAME_STRING(a, b)  (strcmp((a), (b)) == 0)
+
+DEFINE_TYPED_TABLE(StrTab, strtab, const char *, void *, hash_string,
+		SAME_STRING)
+
+/** the table under test */
+typedef enum {
+	IMPL_HASHTAB, IMPL_TYPED
+} Impl;
+
+typedef union {
+	HashTab *ht;
+	SymTab  *st;
+	StrTab  *sst;
+} Table;
+
+/** a hash function over strings, and its form for <code>HashTab</code>, which
+ *  is NULL if the function is too weak to be worth timing */
+typedef struct {
+	const char *name;
+	unsigned int (*hash)(const char *s);
+	unsigned int (*key_hash)(void *key, unsigned int size);
+} StringHash;
+
+/** the kind of string keys */
+typedef enum {
+	KEYS_SEQUENTIAL, KEYS_RANDOM
+} KeyKind;
+
+/** a range of key lengths */
+typedef struct {
+	const char   *name;
+	unsigned int  min, max;
+} KeyLength;
+
+/** a set of distinct identifiers */
+typedef struct {
+	char         **names;
+	unsigned int   num_names;
+	unsigned int   max_names;
+	HashTab       *seen;
+} NameSet;
+
+/* --- global static variables ---------------------------------------------- */
+
+static unsigned long long rng_state = 1;
+static int dummy;
+static volatile unsigned long sink;
+static unsigned long num_allocations;
+
+/* --- function prototypes -------------------------------------------------- */
+
+void bench_tables(Impl impl, unsigned int n);
+void bench_scopes(Impl impl);
+void bench_strings(Impl impl, KeyKind kind, const KeyLength *length,
+		const StringHash *hash, float loadfactor);
+Table fill(Impl impl, unsigned int *keys, unsigned int n, double *worst);
+static inline Table table_init(Impl impl);
+static inline int table_insert(Impl impl, Table t, unsigned int sym);
+static inline Boolean table_search(Impl impl, Table t, unsigned int sym,
+		void **value);
+static inline void table_free(Impl impl, Table t);
+void make_keys(NameSet *set, KeyKind kind, const KeyLength *length,
+		unsigned int n);
+char **make_probes(char **copies, unsigned int n, unsigned int hit_percent,
+		unsigned int *num_hits);
+Table fill_strings(Impl impl, const StringHash *hash, float loadfactor,
+		char **keys, unsigned int n);
+double time_probes(Impl impl, Table t, char **probes, unsigned int num_hits);
+static inline Table string_table_init(Impl impl, const StringHash *hash,
+		float loadfactor);
+static inline int string_table_insert(Impl impl, Table t, char *key);
+static inline Boolean string_table_search(Impl impl, Table t, char *key,
+		void **value);
+static inline void string_table_free(Impl impl, Table t);
+Boolean isolate(void);
+void end_isolated(void);
+void print_usage(unsigned long allocations, unsigned long operations);
+double peak_rss(void);
+unsigned int rnd(unsigned int n);
+void shuffle(unsigned int *a, unsigned int n);
+double seconds(void);
+unsigned int symbol_hash(void *key, unsigned int size);
+int symbol_cmp(void *val1, void *val2);
+void report_collisions(int num_files, char *files[]);
+void collect_names(NameSet *set, const char *filename);
+void add_name(NameSet *set, const char *name);
+void report_set(const char *title, const NameSet *set);
+double search_cost(char **names, unsigned int n, unsigned int size,
+		unsigned int (*hash)(const char *s), Boolean pow2, unsigned int *used,
+		unsigned int *max_chain);
+unsigned int largest_prime_below(unsigned int n);
+unsigned int sum_hash(const char *s);
+unsigned int djb2_hash(const char *s);
+unsigned int fnv1a_hash(const char *s);
+unsigned int djb2_key_hash(void *key, unsigned int size);
+unsigned int fnv1a_key_hash(void *key, unsigned int size);
+unsigned int string_hash(void *key, unsigned int size);
+int string_cmp(void *val1, void *val2);
+
+/* --- workload parameters -------------------------------------------------- */
+static const StringHash string_hashes[] = {
+	{ "sum",       sum_hash,    NULL           },
+	{ "djb2",      djb2_hash,   djb2_key_hash  },
+	{ "fnv-1a",    fnv1a_hash,  fnv1a_key_hash },
+	{ "bytehash",  hash_string, string_hash    }
+};
+
+#define NUM_STRING_HASHES (sizeof(string_hashes) / sizeof(string_hashes[0]))
+
+static const KeyLength key_lengths[] = {
+	{ "4-8",     4,   8 },
+	{ "16-32",  16,  32 },
+	{ "64-128", 64, 128 }
+};
+
+#define NUM_KEY_LENGTHS (sizeof(key_lengths) / sizeof(key_lengths[0]))
+
+static const float loadfactors[] = { 0.5f, 0.75f, 0.9f };
+
+#define NUM_LOADFACTORS (sizeof(loadfactors) / sizeof(loadfactors[0]))
+
+/* --- main routine --------------------------------------------------------- */
+
+int main(int argc, char *argv[])
+{
+	static const unsigned int sizes[] = { 16, 256, 4096, 65536, 1048576 };
+	static const char *impl_names[] = { "HashTab", "typed table" };
+	static const char *kind_names[] = { "sequential", "random" };
+	const StringHash *hash;
+	unsigned int i, l, h, f;
+	KeyKind kind;
+	Impl impl;
+
+	setprogname(argv[0]);
+	if (argc > 1 && strcmp(argv[1], "--collisions") == 0) {
+		report_collisions(argc - 2, argv + 2);
+		freeprogname();
+		return EXIT_SUCCESS;
+	}
+	if (argc != 1) {
+		eprintf("usage: %s [--collisions <file>...]", getprogname());
+	}
+
+	for (impl = IMPL_HASHTAB; impl <= IMPL_TYPED; impl++) {
+		printf("%s%s\n", (impl > IMPL_HASHTAB ? "\n" : ""), impl_names[impl]);
+		printf("%-10s %10s %10s %10s %10s %8s %10s\n", "entries", "insert",
+				"worst", "hit", "miss", "allocs", "RSS");
+		for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+			if (isolate()) {
+				bench_tables(impl, sizes[i]);
+				end_isolated();
+			}
+		}
+		if (isolate()) {
+			bench_scopes(impl);
+			end_isolated();
+		}
+
+		printf("\n%s, %u string keys, %d%% of the searches hit or miss\n",
+				impl_names[impl], NUM_STRING_KEYS, HIT_PERCENT);
+		printf("%-10s %-6s %-8s %4s %10s %10s %10s %8s %10s\n", "keys",
+				"length", "hash", "lf", "insert", "hit", "miss", "allocs",
+				"RSS");
+		for (kind = KEYS_SEQUENTIAL; kind <= KEYS_RANDOM; kind++) {
+			for (l = 0; l < NUM_KEY_LENGTHS; l++) {
+				for (h = 0; h < NUM_STRING_HASHES; h++) {
+					hash = &string_hashes[h];
+					if (hash->key_hash == NULL
+							|| (impl == IMPL_TYPED && hash->hash != hash_string)) {
+						continue;
+					}
+					for (f = 0; f < NUM_LOADFACTORS; f++) {
+						/* only the strong hash function is run at every load
+						 * factor */
+						if (loadfactors[f] != 0.75f && hash->hash != hash_string) {
+							continue;
+						}
+						printf("%-10s %-6s %-8s %4.2f", kind_names[kind],
+								key_lengths[l].name, hash->name, loadfactors[f]);
+						if (isolate()) {
+							bench_strings(impl, kind, &key_lengths[l], hash,
+									loadfactors[f]);
+							end_isolated();
+						}
+					}
+				}
+			}
+		}
+	}
+
+	freeprogname();
+
+	return EXIT_SUCCESS;
+}
+
+/* --- workloads ------------------------------------------------------------ */
+
+/* Fills tables of n entries, chosen at random from 2n symbols, and searches
+ * them for the chosen symbols and for the others, reporting the best time per
+ * operation in nanoseconds. */
+void bench_tables(Impl impl, unsigned int n)
+{
+	unsigned int *symbols, *order, i, j, r, reps;
+	unsigned long allocations = 0;
+	double t, insert, worst, hit, miss;
+	Table ht;
+	void *v;
+
+	symbols = emalloc(2 * n * sizeof(unsigned int));
+	order = emalloc(NUM_LOOKUPS * sizeof(unsigned int));
+	for (i = 0; i < 2 * n; i++) {
+		symbols[i] = i + 1;
+	}
+	shuffle(symbols, 2 * n);
+	for (i = 0; i < NUM_LOOKUPS; i++) {
+		order[i] = rnd(n);
+	}
+
+	reps = (n < NUM_LOOKUPS / 4 ? NUM_LOOKUPS / 4 / n : 1);
+	insert = worst = hit = miss = 0.0;
+	for (r = 0; r < NUM_RUNS; r++) {
+		allocations -= num_allocations;
+		t = seconds();
+		for (j = 0; j < reps; j++) {
+			table_free(impl, fill(impl, symbols, n, NULL));
+		}
+		t = (seconds() - t) / reps / n;
+		insert = (r == 0 || t < insert ? t : insert);
+		allocations += num_allocations;
+
+		ht = fill(impl, symbols, n, &t);
+		worst = (r == 0 || t < worst ? t : worst);
+
+		t = seconds();
+		for (i = 0; i < NUM_LOOKUPS; i++) {
+			if (!table_search(impl, ht, symbols[order[i]], &v)) {
+				eprintf("symbol %u not found", symbols[order[i]]);
+			}
+			sink += (unsigned long) v;
+		}
+		t = (seconds() - t) / NUM_LOOKUPS;
+		hit = (r == 0 || t < hit ? t : hit);
+
+		t = seconds();
+		for (i = 0; i < NUM_LOOKUPS; i++) {
+			if (table_search(impl, ht, symbols[n + order[i]], &v)) {
+				eprintf("symbol %u found", symbols[n + order[i]]);
+			}
+		}
+		t = (seconds() - t) / NUM_LOOKUPS;
+		miss = (r == 0 || t < miss ? t : miss);
+
+		table_free(impl, ht);
+	}
+
+	printf("%-10u %7.1f ns %7.1f us %7.1f ns %7.1f ns", n, insert * 1e9,
+			worst * 1e6, hit * 1e9, miss * 1e9);
+	print_usage(allocations, (unsigned long) NUM_RUNS * reps * n);
+
+	free(order);
+	free(symbols);
+}
+
+/* Runs the subroutines of a large program through a global and a local table,
+ * as the symbol table does, reporting the best time per lookup. */
+void bench_scopes(Impl impl)
+{
+	unsigned int symbols[NUM_GLOBALS + MAX_LOCALS], s, i, j, r, k, n;
+	unsigned long lookups, allocations = 0;
+	double t, best;
+	Table global, local;
+	void *v;
+
+	best = 0.0;
+	for (r = 0; r < NUM_RUNS; r++) {
+		rng_state = 1;
+		for (i = 0; i < NUM_GLOBALS; i++) {
+			symbols[i] = 1 + rnd(16 * NUM_GLOBALS);
+		}
+		global = table_init(impl);
+		for (i = 0; i < NUM_GLOBALS; i++) {
+			table_insert(impl, global, symbols[i]);
+		}
+
+		lookups = 0;
+		allocations -= num_allocations;
+		t = seconds();
+		for (s = 0; s < NUM_SUBROUTINES; s++) {
+			local = table_init(impl);
+			n = 1 + rnd(MAX_LOCALS);
+			for (i = 0; i < n; i++) {
+				symbols[NUM_GLOBALS + i] = 1 + rnd(16 * NUM_GLOBALS);
+				table_insert(impl, local, symbols[NUM_GLOBALS + i]);
+			}
+			/* mostly locals, then globals, then names that are nowhere */
+			for (j = 0; j < n * LOOKUPS_PER_LOCAL; j++) {
+				k = rnd(10);
+				if (k < 6) {
+					k = symbols[NUM_GLOBALS + rnd(n)];
+				} else if (k < 9) {
+					k = symbols[rnd(NUM_GLOBALS)];
+				} else {
+					k = 16 * NUM_GLOBALS + 1 + rnd(NUM_GLOBALS);
+				}
+				if (!table_search(impl, local, k, &v)) {
+					table_search(impl, global, k, &v);
+				}
+				lookups++;
+			}
+			table_free(impl, local);
+		}
+		t = (seconds() - t) / lookups;
+		best = (r == 0 || t < best ? t : best);
+		allocations += num_allocations;
+
+		table_free(impl, global);
+	}
+
+	printf("%-10s %7.1f ns %-32s", "scopes", best * 1e9,
+			"per lookup, allocs per scope");
+	print_usage(allocations, (unsigned long) NUM_RUNS * NUM_SUBROUTINES);
+}
+
+/* Fills a table with string keys, and searches it with copies of the keys,
+ * hit-heavy and miss-heavy, reporting the best time per operation in
+ * nanoseconds, and the allocations per insertion. */
+void bench_strings(Impl impl, KeyKind kind, const KeyLength *length,
+		const StringHash *hash, float loadfactor)
+{
+	NameSet keys = { NULL, 0, 0, NULL };
+	char **copies, **hit_heavy, **miss_heavy;
+	unsigned int n = NUM_STRING_KEYS, i, j, r, reps, num_hits, num_misses;
+	unsigned long allocations = 0;
+	double t, insert, hit, miss;
+	Table st;
+
+	/* the first n keys go into the table, and the other n stay out of it */
+	make_keys(&keys, kind, length, 2 * n);
+	copies = emalloc(2 * n * sizeof(char *));
+	for (i = 0; i < 2 * n; i++) {
+		copies[i] = estrdup(keys.names[i]);
+	}
+	hit_heavy = make_probes(copies, n, HIT_PERCENT, &num_hits);
+	miss_heavy = make_probes(copies, n, 100 - HIT_PERCENT, &num_misses);
+
+	reps = (n < NUM_STRING_LOOKUPS ? NUM_STRING_LOOKUPS / n : 1);
+	insert = hit = miss = 0.0;
+	for (r = 0; r < NUM_RUNS; r++) {
+		allocations -= num_allocations;
+		t = seconds();
+		for (j = 0; j < reps; j++) {
+			string_table_free(impl,
+					fill_strings(impl, hash, loadfactor, keys.names, n));
+		}
+		t = (seconds() - t) / reps / n;
+		insert = (r == 0 || t < insert ? t : insert);
+		allocations += num_allocations;
+
+		st = fill_strings(impl, hash, loadfactor, keys.names, n);
+		t = time_probes(impl, st, hit_heavy, num_hits);
+		hit = (r == 0 || t < hit ? t : hit);
+		t = time_probes(impl, st, miss_heavy, num_misses);
+		miss = (r == 0 || t < miss ? t : miss);
+		string_table_free(impl, st);
+	}
+
+	printf(" %7.1f ns %7.1f ns %7.1f ns", insert * 1e9, hit * 1e9, miss * 1e9);
+	print_usage(allocations, (unsigned long) NUM_RUNS * reps * n);
+
+	for (i = 0; i < 2 * n; i++) {
+		free(keys.names[i]);
+		free(copies[i]);
+	}
+	free(keys.names);
+	free(copies);
+	free(hit_heavy);
+	free(miss_heavy);
+	ht_free(keys.seen, NULL, NULL);
+}
+
+/* --- collision statistics ------------------------------------------------- */
+
+/* Reports the collision statistics for the identifiers of the specified files,
+ * taken together, and for the generated names. */
+void report_collisions(int num_files, char *files[])
+{
+	NameSet sources = { NULL, 0, 0, NULL }, generated = { NULL, 0, 0, NULL };
+	char name[MAX_IDENTIFIER];
+	unsigned int i;
+	int f;
+
+	for (f = 0; f < num_files; f++) {
+		collect_names(&sources, files[f]);
+	}
+	for (i = 1; i <= NUM_GENERATED; i++) {
+		sprintf(name, "a%u", i);
+		add_name(&generated, name);
+	}
+
+	if (num_files > 0) {
+		report_set("identifiers of the files", &sources);
+		printf("\n");
+	}
+	report_set("generated names a1 to a10000", &generated);
+
+	for (i = 0; i < sources.num_names; i++) {
+		free(sources.names[i]);
+	}
+	for (i = 0; i < generated.num_names; i++) {
+		free(generated.names[i]);
+	}
+	free(sources.names);
+	free(generated.names);
+	if (sources.seen) {
+		ht_free(sources.seen, NULL, NULL);
+	}
+	ht_free(generated.seen, NULL, NULL);
+}
+
+/* Adds the identifiers of the specified file to the set.  The file is taken as
+ * plain text: an identifier is a letter or underscore, followed by letters,
+ * digits, and underscores, and anything too long is cut short. */
+void collect_names(NameSet *set, const char *filename)
+{
+	FILE *in_file;
+	char name[MAX_IDENTIFIER];
+	unsigned int length;
+	int c;
+
+	if ((in_file = fopen(filename, "r")) == NULL) {
+		eprintf("file '%s' could not be opened:", filename);
+	}
+
+	length = 0;
+	do {
+		c = getc(in_file);
+		if (c != EOF && (isalpha(c) || c == '_' || (length > 0 && isdigit(c)))) {
+			if (length < MAX_IDENTIFIER - 1) {
+				name[length++] = (char) c;
+			}
+		} else if (length > 0) {
+			name[length] = '\0';
+			add_name(set, name);
+			length = 0;
+		}
+	} while (c != EOF);
+
+	fclose(in_file);
+}
+
+void add_name(NameSet *set, const char *name)
+{
+	char *copy;
+	int ret;
+
+	if (set->seen == NULL
+			&& (set->seen = ht_init(0.75f, string_hash, string_cmp)) == NULL) {
+		eprintf("hash table could not be initialised");
+	}
+	copy = estrdup(name);
+	if ((ret = ht_insert(set->seen, copy, NULL)) != EXIT_SUCCESS) {
+		free(copy);
+		if (ret != HASH_TABLE_KEY_VALUE_PAIR_EXISTS) {
+			eprintf("identifier '%s' could not be inserted", name);
+		}
+		return;
+	}
+	if (set->num_names == set->max_names) {
+		set->max_names = (set->max_names ? 2 * set->max_names : 1024);
+		set->names = erealloc(set->names, set->max_names * sizeof(char *));
+	}
+	set->names[set->num_names++] = copy;
+}
+
+/* Reports, for each hash function and each way of sizing the table, the
+ * number of buckets used, the longest chain, and the cost of a successful
+ * search against that of a uniformly random hash. */
+void report_set(const char *title, const NameSet *set)
+{
+	static const char *sizing_names[] = { "prime", "pow2" };
+	unsigned int n = set->num_names, size[2], i, s, used, max_chain;
+	double cost, expected;
+
+	if (n == 0) {
+		printf("%s: none\n", title);
+		return;
+	}
+
+	/* the sizes that the table has grown to, once it holds all of the names */
+	for (i = 4; i < 31 && n > LOADFACTOR * (1u << i); i++)
+		;
+	size[0] = largest_prime_below(1u << i);
+	size[1] = 1u << i;
+
+	printf("%s: %u distinct\n", title, n);
+	printf("%-10s %-6s %10s %10s %10s %10s\n", "hash", "sizing", "buckets",
+			"used", "longest", "cost");
+	for (i = 0; i < NUM_STRING_HASHES; i++) {
+		for (s = 0; s < 2; s++) {
+			cost = search_cost(set->names, n, size[s], string_hashes[i].hash,
+					s == 1, &used, &max_chain);
+			expected = 1.0 + (n - 1.0) / (2.0 * size[s]);
+			printf("%-10s %-6s %10u %10u %10u %10.2f\n",
+					string_hashes[i].name, sizing_names[s], size[s], used,
+					max_chain, cost / expected);
+		}
+	}
+}
+
+/* Spreads the names over a table of the specified size, and returns the mean
+ * number of entries that a successful search visits, that is, the sum over
+ * the buckets of 1 + 2 + ... + b for a chain of b entries, over n. */
+double search_cost(char **names, unsigned int n, unsigned int size,
+		unsigned int (*hash)(const char *s), Boolean pow2, unsigned int *used,
+		unsigned int *max_chain)
+{
+	unsigned int *chains, i, h;
+	double visits;
+
+	chains = emalloc(size * sizeof(unsigned int));
+	memset(chains, 0, size * sizeof(unsigned int));
+	for (i = 0; i < n; i++) {
+		h = hash(names[i]);
+		chains[pow2 ? h & (size - 1) : h % size]++;
+	}
+
+	visits = 0.0;
+	*used = *max_chain = 0;
+	for (i = 0; i < size; i++) {
+		visits += chains[i] * (chains[i] + 1.0) / 2.0;
+		*used += (chains[i] > 0);
+		*max_chain = (chains[i] > *max_chain ? chains[i] : *max_chain);
+	}
+	free(chains);
+
+	return visits / n;
+}
+
+/* the size of a prime table, as hashtable.c takes it */
+unsigned int largest_prime_below(unsigned int n)
+{
+	unsigned int p, d;
+
+	for (p = n - 1; p > 2; p--) {
+		for (d = 2; d * d <= p && p % d != 0; d++)
+			;
+		if (d * d > p) {
+			return p;
+		}
+	}
+
+	return 2;
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+/* Fills a table with the first n of the specified keys.  Unless worst is NULL,
+ * each insertion is timed, and the longest time is returned in it. */
+Table fill(Impl impl, unsigned int *keys, unsigned int n, double *worst)
+{
+	Table ht;
+	unsigned int i;
+	int ret;
+	double t;
+
+	ht = table_init(impl);
+	if (worst != NULL) {
+		*worst = 0.0;
+	}
+	for (i = 0; i < n; i++) {
+		if (worst == NULL) {
+			ret = table_insert(impl, ht, keys[i]);
+		} else {
+			t = seconds();
+			ret = table_insert(impl, ht, keys[i]);
+			t = seconds() - t;
+			*worst = (t > *worst ? t : *worst);
+		}
+		if (ret != EXIT_SUCCESS) {
+			eprintf("symbol %u could not be inserted", keys[i]);
+		}
+	}
+
+	return ht;
+}
+
+/* The operations on the table under test.  The choice of table is a branch
+ * that is always taken the same way, so it costs next to nothing, and each
+ * call stays open to inlining. */
+
+static inline Table table_init(Impl impl)
+{
+	Table t;
+
+	if (impl == IMPL_TYPED) {
+		t.st = symtab_init(0.75f);
+	} else {
+		t.ht = ht_init(0.75f, symbol_hash, symbol_cmp);
+	}
+	if (t.ht == NULL) {
+		eprintf("hash table could not be initialised");
+	}
+
+	return t;
+}
+
+static inline int table_insert(Impl impl, Table t, unsigned int sym)
+{
+	return (impl == IMPL_TYPED ? symtab_insert(t.st, sym, &dummy)
+			: ht_insert(t.ht, SYMBOL_KEY(sym), &dummy));
+}
+
+static inline Boolean table_search(Impl impl, Table t, unsigned int sym,
+		void **value)
+{
+	return (impl == IMPL_TYPED ? symtab_search(t.st, sym, value)
+			: ht_search(t.ht, SYMBOL_KEY(sym), value));
+}
+
+static inline void table_free(Impl impl, Table t)
+{
+	if (impl == IMPL_TYPED) {
+		symtab_free(t.st, NULL);
+	} else {
+		ht_free(t.ht, NULL, NULL);
+	}
+}
+
+/* Adds n distinct keys to the set.  The length of each key is chosen at random
+ * from the specified range.  Sequential keys are a run of 'x' followed by the
+ * number of the key, as generated names are; random keys are identifiers. */
+void make_keys(NameSet *set, KeyKind kind, const KeyLength *length,
+		unsigned int n)
+{
+	static const char chars[] =
+		"abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_0123456789";
+	char key[MAX_IDENTIFIER], digits[16];
+	unsigned int i, l, d;
+
+	for (i = 0; set->num_names < n; i++) {
+		l = length->min + rnd(length->max - length->min + 1);
+		if (kind == KEYS_SEQUENTIAL) {
+			d = (unsigned int) sprintf(digits, "%u", i);
+			l = (l > d ? l - d : 0);
+			memset(key, 'x', l);
+			strcpy(key + l, digits);
+		} else {
+			key[0] = chars[rnd(53)];
+			for (d = 1; d < l; d++) {
+				key[d] = chars[rnd(sizeof(chars) - 1)];
+			}
+			key[l] = '\0';
+		}
+		add_name(set, key);
+	}
+}
+
+/* Returns the keys to search for, chosen at random from the 2n copies of the
+ * keys, and, in num_hits, how many of them are in the table: each is one of the
+ * first n with the specified chance in a hundred. */
+char **make_probes(char **copies, unsigned int n, unsigned int hit_percent,
+		unsigned int *num_hits)
+{
+	char **probes;
+	unsigned int i;
+
+	probes = emalloc(NUM_STRING_LOOKUPS * sizeof(char *));
+	*num_hits = 0;
+	for (i = 0; i < NUM_STRING_LOOKUPS; i++) {
+		if (rnd(100) < hit_percent) {
+			probes[i] = copies[rnd(n)];
+			(*num_hits)++;
+		} else {
+			probes[i] = copies[n + rnd(n)];
+		}
+	}
+
+	return probes;
+}
+
+Table fill_strings(Impl impl, const StringHash *hash, float loadfactor,
+		char **keys, unsigned int n)
+{
+	Table st;
+	unsigned int i;
+
+	st = string_table_init(impl, hash, loadfactor);
+	for (i = 0; i < n; i++) {
+		if (string_table_insert(impl, st, keys[i]) != EXIT_SUCCESS) {
+			eprintf("key '%s' could not be inserted", keys[i]);
+		}
+	}
+
+	return st;
+}
+
+/* Searches the table for each of the probes, and returns the time per search,
+ * after checking that the expected number of them were found. */
+double time_probes(Impl impl, Table t, char **probes, unsigned int num_hits)
+{
+	unsigned int i, found = 0;
+	double start;
+	void *v;
+
+	start = seconds();
+	for (i = 0; i < NUM_STRING_LOOKUPS; i++) {
+		found += string_table_search(impl, t, probes[i], &v);
+	}
+	start = seconds() - start;
+	if (found != num_hits) {
+		eprintf("%u keys found instead of %u", found, num_hits);
+	}
+
+	return start / NUM_STRING_LOOKUPS;
+}
+
+static inline Table string_table_init(Impl impl, const StringHash *hash,
+		float loadfactor)
+{
+	Table t;
+
+	if (impl == IMPL_TYPED) {
+		t.sst = strtab_init(loadfactor);
+	} else {
+		t.ht = ht_init(loadfactor, hash->key_hash, string_cmp);
+	}
+	if (t.ht == NULL) {
+		eprintf("hash table could not be initialised");
+	}
+
+	return t;
+}
+
+static inline int string_table_insert(Impl impl, Table t, char *key)
+{
+	return (impl == IMPL_TYPED ? strtab_insert(t.sst, key, &dummy)
+			: ht_insert(t.ht, key, &dummy));
+}
+
+static inline Boolean string_table_search(Impl impl, Table t, char *key,
+		void **value)
+{
+	return (impl == IMPL_TYPED ? strtab_search(t.sst, key, value)
+			: ht_search(t.ht, key, value));
+}
+
+static inline void string_table_free(Impl impl, Table t)
+{
+	if (impl == IMPL_TYPED) {
+		strtab_free(t.sst, NULL);
+	} else {
+		ht_free(t.ht, NULL, NULL);
+	}
+}
+
+/* a random number in [0, n), from a 64-bit linear congruential generator */
+unsigned int rnd(unsigned int n)
+{
+	rng_state = rng_state * 6364136223846793005ull + 1442695040888963407ull;
+	return (unsigned int) ((rng_state >> 33) % n);
+}
+
+void shuffle(unsigned int *a, unsigned int n)
+{
+	unsigned int i, j, t;
+
+	for (i = n - 1; i > 0; i--) {
+		j = rnd(i + 1);
+		t = a[i];
+		a[i] = a[j];
+		a[j] = t;
+	}
+}
+
+double seconds(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* --- process functions ---------------------------------------------------- */
+
+/* Forks a process to run a workload in, so that its peak resident set is its
+ * own, and it starts from the fixed seed.  Returns TRUE in the child, which
+ * must end with end_isolated, and FALSE in the parent, once the child is done;
+ * if the child fails, so does the parent. */
+Boolean isolate(void)
+{
+	pid_t pid;
+	int status;
+
+	fflush(stdout);
+	if ((pid = fork()) < 0) {
+		eprintf("workload could not be forked:");
+	}
+	if (pid == 0) {
+		rng_state = 1;
+		return TRUE;
+	}
+	if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status)
+			|| WEXITSTATUS(status) != EXIT_SUCCESS) {
+		eprintf("workload failed");
+	}
+
+	return FALSE;
+}
+
+void end_isolated(void)
+{
+	fflush(stdout);
+	_exit(EXIT_SUCCESS);
+}
+
+/* Ends a row with the allocations per operation and the peak resident set. */
+void print_usage(unsigned long allocations, unsigned long operations)
+{
+#ifdef __GLIBC__
+	printf(" %8.3f", (double) allocations / operations);
+#else
+	(void) allocations;
+	(void) operations;
+	printf(" %8s", "-");
+#endif
+	printf(" %7.1f MB\n", peak_rss());
+}
+
+/* the peak resident set of this process, in megabytes */
+double peak_rss(void)
+{
+	struct rusage usage;
+
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+	return usage.ru_maxrss / 1024.0;
+#endif
+}
+
+/* --- allocation counting -------------------------------------------------- */
+
+/* The GNU C library lets a program replace its allocator, and exports the
+ * allocator under other names, so the allocations of the tables are counted by
+ * replacing malloc, calloc, and realloc with functions that count the call and
+ * pass it on.  Blocks are still released by the library's own free. */
+
+#ifdef __GLIBC__
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size)
+{
+	num_allocations++;
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+	num_allocations++;
+	return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	num_allocations++;
+	return __libc_realloc(ptr, size);
+}
+
+#endif /* __GLIBC__ */
+
+/* --- hash helper functions ------------------------------------------------ */
+
+unsigned int symbol_hash(void *key, unsigned int size)
+{
+	return KEY_SYMBOL(key) % size;
+}
+
+int symbol_cmp(void *val1, void *val2)
+{
+	unsigned int s1 = KEY_SYMBOL(val1), s2 = KEY_SYMBOL(val2);
+
+	return (s1 > s2) - (s1 < s2);
+}
+
+/* the sum of the characters, as testhashtable.c hashes its keys */
+unsigned int sum_hash(const char *s)
+{
+	unsigned int h = 0;
+
+	for (; *s; s++) {
+		h += (unsigned char) *s;
+	}
+
+	return h;
+}
+
+/* Bernstein's h * 33 + c */
+unsigned int djb2_hash(const char *s)
+{
+	unsigned int h = 5381;
+
+	for (; *s; s++) {
+		h = h * 33 + (unsigned char) *s;
+	}
+
+	return h;
+}
+
+/* FNV-1a, as intern.c hashes names */
+unsigned int fnv1a_hash(const char *s)
+{
+	unsigned int h = 2166136261u;
+
+	for (; *s; s++) {
+		h ^= (unsigned char) *s;
+		h *= 16777619u;
+	}
+
+	return h;
+}
+
+unsigned int djb2_key_hash(void *key, unsigned int size)
+{
+	return djb2_hash(key) % size;
+}
+
+unsigned int fnv1a_key_hash(void *key, unsigned int size)
+{
+	return fnv1a_hash(key) % size;
+}
+
+unsigned int string_hash(void *key, unsigned int size)
+{
+	return hash_string(key) % size;
+}
+
+int string_cmp(void *val1, void *val2)
+{
+	return strcmp((char *) val1, (char *) val2);
+}
@@ -0,0 +1,201 @@
+/**
+ * @file    benchscanner.c
+ * @brief   A driver program to measure the speed of the scanner unit.
+ *
+ * The source is scanned from start to end, through <code>init_scanner</code>
+ * and <code>get_token</code>, several times, and the best run is reported in
+ * megabytes and tokens per second, together with the number of allocations
+ * made per token.  Sources to measure are made by <code>mkcorpus</code>.
+ *
+ * With <code>--scaling</code>, the source is then also scanned in parallel on
+ * 1, 2, 4, and 8 threads.  Each parallel scan must hand out exactly the tokens
+ * of the sequential one, and its best time is reported against that of the
+ * sequential scan.
+ *
+ * Scanner errors end the program, as they would in the compiler, so the source
+ * must scan cleanly.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "boolean.h"
+#include "error.h"
+#include "intern.h"
+#include "scanner.h"
+#include "token.h"
+
+#define NUM_RUNS 5
+
+/* --- function prototypes -------------------------------------------------- */
+
+double scan_source(const char *filename, int num_threads, Token **tokens,
+		size_t *num_tokens);
+void report_scaling(const char *filename, double base);
+Boolean same_tokens(const Token *a, const Token *b, size_t n);
+double seconds(void);
+
+/* --- main routine --------------------------------------------------------- */
+
+int main(int argc, char *argv[])
+{
+	FILE *in_file;
+	char *filename;
+	long size = 0;
+	size_t num_tokens;
+	unsigned long allocations;
+	double best, t;
+	Boolean scaling;
+	unsigned int r;
+
+	setprogname(argv[0]);
+
+	scaling = (argc == 3 && strcmp(argv[1], "--scaling") == 0);
+	if (argc != 2 && !scaling) {
+		eprintf("usage: %s [--scaling] <filename>", getprogname());
+	}
+	filename = argv[argc - 1];
+	setsrcname(filename);
+
+	if ((in_file = fopen(filename, "r")) == NULL
+			|| fseek(in_file, 0, SEEK_END) < 0
+			|| (size = ftell(in_file)) < 0) {
+		eprintf("file '%s' could not be opened:", filename);
+	}
+	fclose(in_file);
+
+	/* the first run also counts the allocations */
+	allocations = get_allocation_count();
+	best = scan_source(filename, 0, NULL, &num_tokens);
+	allocations = get_allocation_count() - allocations;
+	for (r = 1; r < NUM_RUNS; r++) {
+		t = scan_source(filename, 0, NULL, &num_tokens);
+		best = (t < best ? t : best);
+	}
+
+	printf("%ld bytes, %lu tokens, best of %d runs: %.4f s\n", size,
+			(unsigned long) num_tokens, NUM_RUNS, best);
+	printf("%12.1f MB/s\n", size / best / 1e6);
+	printf("%12.2f Mtokens/s\n", num_tokens / best / 1e6);
+	printf("%12.3g allocations per token (%lu in all)\n",
+			(double) allocations / num_tokens, allocations);
+
+	if (scaling) {
+		report_scaling(filename, best);
+	}
+
+	freeprogname();
+	freesrcname();
+
+	return EXIT_SUCCESS;
+}
+
+/* --- functions ------------------------------------------------------------ */
+
+/* Scans the whole of the specified file, in parallel if the number of threads
+ * is positive, and returns the time taken, from initialising the scanner to the
+ * end of the source.  Unless tokens is NULL, the tokens are returned in a newly
+ * allocated array. */
+double scan_source(const char *filename, int num_threads, Token **tokens,
+		size_t *num_tokens)
+{
+	FILE *in_file;
+	Token token;
+	size_t n, size;
+	double start, elapsed;
+
+	if ((in_file = fopen(filename, "r")) == NULL) {
+		eprintf("file '%s' could not be opened:", filename);
+	}
+
+	size = 4096;
+	if (tokens != NULL) {
+		*tokens = emalloc(size * sizeof(Token));
+	}
+	n = 0;
+
+	start = seconds();
+	init_intern();
+	init_scanner(in_file);
+	if (num_threads > 0) {
+		scan_in_parallel(num_threads);
+	}
+	do {
+		get_token(&token);
+		if (tokens != NULL) {
+			if (n == size) {
+				size *= 2;
+				*tokens = erealloc(*tokens, size * sizeof(Token));
+			}
+			(*tokens)[n] = token;
+		}
+		n++;
+	} while (token.type != TOK_EOF);
+	elapsed = seconds() - start;
+
+	release_scanner();
+	release_intern();
+	fclose(in_file);
+
+	*num_tokens = n;
+	return elapsed;
+}
+
+/* Scans the specified file in parallel on a growing number of threads, and
+ * reports the best time for each against the specified sequential time. */
+void report_scaling(const char *filename, double base)
+{
+	static const int threads[] = { 1, 2, 4, 8 };
+	Token *reference, *tokens;
+	size_t num_reference, num_tokens;
+	double best, t;
+	unsigned int i, r;
+
+	scan_source(filename, 0, &reference, &num_reference);
+	printf("\n%ld processors online\n", sysconf(_SC_NPROCESSORS_ONLN));
+	printf("%-12s %10.4f s\n", "sequential", base);
+
+	for (i = 0; i < sizeof(threads) / sizeof(threads[0]); i++) {
+		best = 0.0;
+		for (r = 0; r < NUM_RUNS; r++) {
+			t = scan_source(filename, threads[i], &tokens, &num_tokens);
+			if (num_tokens != num_reference
+					|| !same_tokens(tokens, reference, num_tokens)) {
+				eprintf("parallel scan on %d threads differs", threads[i]);
+			}
+			free(tokens);
+			best = (r == 0 || t < best ? t : best);
+		}
+		printf("%2d thread%-4s %10.4f s  %5.2fx\n", threads[i],
+				(threads[i] > 1 ? "s" : ""), best, base / best);
+	}
+
+	free(reference);
+}
+
+Boolean same_tokens(const Token *a, const Token *b, size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		if (a[i].type != b[i].type || a[i].offset != b[i].offset
+				|| a[i].length != b[i].length
+				|| (a[i].type == TOK_NUM && a[i].value != b[i].value)
+				|| (a[i].type == TOK_ID && a[i].symbol != b[i].symbol)) {
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+double seconds(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
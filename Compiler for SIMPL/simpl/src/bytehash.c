@@ -0,0 +1,57 @@
+/**
+ * @file    bytehash.c
+ * @brief   A fast, well-mixing hash function over the bytes of a key.
+ *
+ * The bytes are read eight (and then four) at a time with memcpy, which the
+ * compiler turns into a single unaligned load where the processor allows it.
+ * A key that ends in NUL bytes would hash as one without them, were it not for
+ * its length, which is taken into the state first.
+ */
+
+#include "bytehash.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/* the multiplier of FxHash, and the final multiplier of MurmurHash3 */
+#define FX_SEED  0x517cc1b727220a95ull
+#define MIX_SEED 0xff51afd7ed558ccdull
+
+#define FX_ADD(h, w) ((((h) << 5 | (h) >> 59) ^ (w)) * FX_SEED)
+
+/* --- hash functions ------------------------------------------------------- */
+
+unsigned int hash_bytes(const void *key, size_t length)
+{
+	const unsigned char *p = key;
+	uint64_t h, w;
+	uint32_t v;
+
+	h = FX_ADD((uint64_t) 0, (uint64_t) length);
+	for (; length >= 8; p += 8, length -= 8) {
+		memcpy(&w, p, 8);
+		h = FX_ADD(h, w);
+	}
+	if (length >= 4) {
+		memcpy(&v, p, 4);
+		h = FX_ADD(h, v);
+		p += 4;
+		length -= 4;
+	}
+	for (; length > 0; p++, length--) {
+		h = FX_ADD(h, *p);
+	}
+
+	/* the low bits of a product depend only on the low bits of its factors,
+	 * so the high bits are folded in */
+	h ^= h >> 33;
+	h *= MIX_SEED;
+	h ^= h >> 33;
+
+	return (unsigned int) h;
+}
+
+unsigned int hash_string(const char *s)
+{
+	return hash_bytes(s, strlen(s));
+}
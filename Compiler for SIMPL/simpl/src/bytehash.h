@@ -0,0 +1,39 @@
+/**
+ * @file    bytehash.h
+ * @brief   A fast, well-mixing hash function over the bytes of a key.
+ *
+ * The function takes eight bytes at a time into a 64-bit state, rotating and
+ * multiplying as FxHash does, and finishes by folding the high bits of the
+ * state into the low ones.  Every bit of the result therefore depends on every
+ * byte of the key, so that the result may be reduced to the size of a table by
+ * masking, and keys that differ in a single character, such as
+ * <code>a1</code>, <code>a2</code>, and so on, still spread evenly.
+ */
+
+#ifndef BYTEHASH_H
+#define BYTEHASH_H
+
+#include <stddef.h>
+
+/**
+ * Returns the hash code of the specified bytes.
+ *
+ * @param[in]   key
+ *     the bytes to hash
+ * @param[in]   length
+ *     the number of bytes
+ * @return      the hash code
+ */
+unsigned int hash_bytes(const void *key, size_t length);
+
+/**
+ * Returns the hash code of the specified string, which is that of its
+ * characters, not counting the terminating NUL.
+ *
+ * @param[in]   s
+ *     the NUL-terminated string to hash
+ * @return      the hash code
+ */
+unsigned int hash_string(const char *s);
+
+#endif /* BYTEHASH_H */
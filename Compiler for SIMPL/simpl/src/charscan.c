@@ -0,0 +1,177 @@
+/**
+ * @file    charscan.c
+ * @brief   Bulk character scanning over the source buffer.
+ *
+ * Each scan has a plain version, which also finishes the tail of the buffer
+ * for the vector versions, and, on x86, an SSE2 and an AVX2 version.  SSE2 is
+ * part of x86-64, so its version is compiled whenever the compiler targets it;
+ * the AVX2 version is compiled for that instruction set only, by a function
+ * attribute, and is only called if the processor reports support for it.
+ */
+
+#include "charscan.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_SCAN
+#include <immintrin.h>
+#endif
+
+/* --- global static variables ---------------------------------------------- */
+
+static size_t (*blanks_scanner)(const char *, size_t, size_t);
+static size_t (*comment_scanner)(const char *, size_t, size_t);
+
+/* --- function prototypes -------------------------------------------------- */
+
+static size_t scan_blanks_plain(const char *buf, size_t pos, size_t end);
+static size_t scan_comment_plain(const char *buf, size_t pos, size_t end);
+#if defined(HAVE_X86_SCAN) && defined(__SSE2__)
+static size_t scan_blanks_sse2(const char *buf, size_t pos, size_t end);
+static size_t scan_comment_sse2(const char *buf, size_t pos, size_t end);
+#endif
+#ifdef HAVE_X86_SCAN
+static size_t scan_blanks_avx2(const char *buf, size_t pos, size_t end);
+static size_t scan_comment_avx2(const char *buf, size_t pos, size_t end);
+#endif
+
+/* --- character scanning interface ----------------------------------------- */
+
+void init_charscan(void)
+{
+	blanks_scanner = scan_blanks_plain;
+	comment_scanner = scan_comment_plain;
+#if defined(HAVE_X86_SCAN) && defined(__SSE2__)
+	blanks_scanner = scan_blanks_sse2;
+	comment_scanner = scan_comment_sse2;
+#endif
+#ifdef HAVE_X86_SCAN
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		blanks_scanner = scan_blanks_avx2;
+		comment_scanner = scan_comment_avx2;
+	}
+#endif
+}
+
+size_t scan_blanks(const char *buf, size_t pos, size_t end)
+{
+	return blanks_scanner(buf, pos, end);
+}
+
+size_t scan_comment_text(const char *buf, size_t pos, size_t end)
+{
+	return comment_scanner(buf, pos, end);
+}
+
+/* --- plain versions ------------------------------------------------------- */
+
+static size_t scan_blanks_plain(const char *buf, size_t pos, size_t end)
+{
+	while (pos < end && (buf[pos] == ' ' || buf[pos] == '\t')) {
+		pos++;
+	}
+
+	return pos;
+}
+
+static size_t scan_comment_plain(const char *buf, size_t pos, size_t end)
+{
+	while (pos < end && buf[pos] != '(' && buf[pos] != '*'
+			&& buf[pos] != '\n') {
+		pos++;
+	}
+
+	return pos;
+}
+
+/* --- SSE2 versions -------------------------------------------------------- */
+
+#if defined(HAVE_X86_SCAN) && defined(__SSE2__)
+
+static size_t scan_blanks_sse2(const char *buf, size_t pos, size_t end)
+{
+	const __m128i space = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t');
+	__m128i v;
+	unsigned int mask;
+
+	for (; pos + 16 <= end; pos += 16) {
+		v = _mm_loadu_si128((const __m128i *) (buf + pos));
+		mask = (unsigned int) _mm_movemask_epi8(
+				_mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab)));
+		if (mask != 0xffff) {
+			return pos + __builtin_ctz(~mask);
+		}
+	}
+
+	return scan_blanks_plain(buf, pos, end);
+}
+
+static size_t scan_comment_sse2(const char *buf, size_t pos, size_t end)
+{
+	const __m128i lpar = _mm_set1_epi8('('), star = _mm_set1_epi8('*'),
+		  newline = _mm_set1_epi8('\n');
+	__m128i v;
+	unsigned int mask;
+
+	for (; pos + 16 <= end; pos += 16) {
+		v = _mm_loadu_si128((const __m128i *) (buf + pos));
+		mask = (unsigned int) _mm_movemask_epi8(
+				_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, lpar),
+										  _mm_cmpeq_epi8(v, star)),
+							 _mm_cmpeq_epi8(v, newline)));
+		if (mask != 0) {
+			return pos + __builtin_ctz(mask);
+		}
+	}
+
+	return scan_comment_plain(buf, pos, end);
+}
+
+#endif /* HAVE_X86_SCAN && __SSE2__ */
+
+/* --- AVX2 versions -------------------------------------------------------- */
+
+#ifdef HAVE_X86_SCAN
+
+__attribute__((target("avx2")))
+static size_t scan_blanks_avx2(const char *buf, size_t pos, size_t end)
+{
+	const __m256i space = _mm256_set1_epi8(' '), tab = _mm256_set1_epi8('\t');
+	__m256i v;
+	unsigned int mask;
+
+	for (; pos + 32 <= end; pos += 32) {
+		v = _mm256_loadu_si256((const __m256i *) (buf + pos));
+		mask = (unsigned int) _mm256_movemask_epi8(_mm256_or_si256(
+				_mm256_cmpeq_epi8(v, space), _mm256_cmpeq_epi8(v, tab)));
+		if (mask != 0xffffffffu) {
+			return pos + __builtin_ctz(~mask);
+		}
+	}
+
+	return scan_blanks_plain(buf, pos, end);
+}
+
+__attribute__((target("avx2")))
+static size_t scan_comment_avx2(const char *buf, size_t pos, size_t end)
+{
+	const __m256i lpar = _mm256_set1_epi8('('), star = _mm256_set1_epi8('*'),
+		  newline = _mm256_set1_epi8('\n');
+	__m256i v;
+	unsigned int mask;
+
+	for (; pos + 32 <= end; pos += 32) {
+		v = _mm256_loadu_si256((const __m256i *) (buf + pos));
+		mask = (unsigned int) _mm256_movemask_epi8(
+				_mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, lpar),
+												_mm256_cmpeq_epi8(v, star)),
+								_mm256_cmpeq_epi8(v, newline)));
+		if (mask != 0) {
+			return pos + __builtin_ctz(mask);
+		}
+	}
+
+	return scan_comment_plain(buf, pos, end);
+}
+
+#endif /* HAVE_X86_SCAN */
@@ -0,0 +1,55 @@
+/**
+ * @file    charscan.h
+ * @brief   Bulk character scanning over the source buffer, used by the scanner
+ *          to skip blanks and comment text many bytes at a time.
+ *
+ * On x86 processors, the scans examine 16 (SSE2) or 32 (AVX2) bytes at a time;
+ * the widest variant that the processor supports is chosen at run time.
+ * Elsewhere, or if the processor supports neither, a plain loop is used.
+ */
+
+#ifndef CHARSCAN_H
+#define CHARSCAN_H
+
+#include <stddef.h>
+
+/**
+ * Selects the scanning routines for the processor on which the program runs.
+ * This must be called before any of the other functions.
+ */
+void init_charscan(void);
+
+/**
+ * Skips the blanks, that is, spaces and horizontal tabs, at the specified
+ * offset in the specified buffer.
+ *
+ * @param[in]   buf
+ *     the buffer to scan
+ * @param[in]   pos
+ *     the offset in the buffer at which to start the scan
+ * @param[in]   end
+ *     the offset just past the last character to scan
+ * @return      the offset of the first character at or after
+ *              <code>pos</code> that is not a blank, or <code>end</code> if
+ *              there is no such character
+ */
+size_t scan_blanks(const char *buf, size_t pos, size_t end);
+
+/**
+ * Finds the first character in the specified buffer that is significant inside
+ * a comment, namely, <code>'('</code>, <code>'*'</code>, or a newline.  Every
+ * other character in a comment only advances the column.
+ *
+ * @param[in]   buf
+ *     the buffer to scan
+ * @param[in]   pos
+ *     the offset in the buffer at which to start the scan
+ * @param[in]   end
+ *     the offset just past the last character to scan
+ * @return      the offset of the first significant character at or after
+ *              <code>pos</code>, or <code>end</code> if there is no such
+ *              character
+ */
+size_t scan_comment_text(const char *buf, size_t pos, size_t end);
+
+#endif /* CHARSCAN_H */
@@ -15,6 +15,7 @@
 #include "boolean.h"
 #include "codegen.h"
 #include "error.h"
+#include "intern.h"
 #include "valtypes.h"
 
 /* --- type definitions and constants --------------------------------------- */
@@ -52,7 +53,7 @@ typedef struct {
 
 typedef struct body_s Body;
 struct body_s {
-	char   *name;
+	Symbol  name;
 	IDprop *idprop;
 	Code   *code;
 	int     ip;
@@ -204,7 +205,8 @@ static const char *java_types[] = {
 #define JASM_EXT     ".jasmin"
 
 static char   *class_name;    /**< the class name                             */
-static char   *function_name; /**< the name of current function               */
+static Symbol  function_name; /**< the name of current function               */
+static Symbol  main_name;     /**< the name of the main routine               */
 static char   *jasm_name;     /**< the jasmin file name                       */
 static int     code_size;     /**< the current code array size                */
 static int     ip;            /**< the instruction pointer                    */
@@ -224,15 +226,16 @@ static void adjust_stack(BC *instr);
 void init_code_generation(void)
 {
 	bodies = NULL;
+	main_name = intern("main", sizeof("main") - 1);
 }
 
-void init_subroutine_codegen(const char *name, IDprop *p)
+void init_subroutine_codegen(Symbol name, IDprop *p)
 {
 	max_stack_depth = stack_depth = 0;
 	ip = 0;
 	code = emalloc(sizeof(Code) * INITIAL_SIZE);
 	code_size = INITIAL_SIZE;
-	function_name = estrdup(name);
+	function_name = name;
 	idprop = p;
 }
 
@@ -259,12 +262,12 @@ void close_subroutine_codegen(int varwidth)
 	
 }
 
-void set_class_name(char *cname)
+void set_class_name(Symbol cname)
 {
 	size_t class_name_len;
 
-	class_name = estrdup(cname);
-	class_name_len = strlen(class_name);
+	class_name = estrdup(symbol_name(cname));
+	class_name_len = symbol_length(cname);
 
 	jasm_name = emalloc(class_name_len + sizeof(JASM_EXT));
 	strcpy(jasm_name, class_name);
@@ -328,7 +331,7 @@ void gen_2(Bytecode opcode, int operand)
 	adjust_stack(&instruction_set[opcode]);
 }
 
-void gen_call(char *fname, IDprop *idprop)
+void gen_call(Symbol fname, IDprop *idprop)
 {
 	char *fpath;
 	unsigned int i;
@@ -345,11 +348,11 @@ void gen_call(char *fname, IDprop *idprop)
 	 *  -- 2 for return type, including possibility of array type
 	 * the multiplier of 2 includes the possibilities of array types
 	 */
-	fpath = emalloc(strlen(class_name) + strlen(fname) +
+	fpath = emalloc(strlen(class_name) + symbol_length(fname) +
 			(6 + 2 * idprop->nparams) * sizeof(char));
 	strcpy(fpath, class_name);
 	strcat(fpath, ".");
-	strcat(fpath, fname);
+	strcat(fpath, symbol_name(fname));
 	strcat(fpath, "(");
 	for (i = 0; i < idprop->nparams; i++) {
 		if (IS_ARRAY_TYPE(idprop->params[i])) {
@@ -589,13 +592,13 @@ static void dump_method(FILE *file, Body *b)
 	int i;
 	unsigned int k;
 
-	if (strcmp(b->name, "main") == 0) {
+	if (b->name == main_name) {
 
 		fprintf(file, ".method public static main([Ljava/lang/String;)V\n");
 
 	} else {
 
-		fprintf(file, ".method public static %s(", b->name);
+		fprintf(file, ".method public static %s(", symbol_name(b->name));
 		for (k = 0; k < b->idprop->nparams; k++) {
 			if (IS_ARRAY(b->idprop->params[k])) {
 				fputs("[", file);
@@ -8,6 +8,7 @@
 #ifndef CODEGEN_H
 #define CODEGEN_H
 
+#include "intern.h"
 #include "jvm.h"
 #include "symboltable.h"
 #include "token.h"
@@ -76,7 +77,7 @@ void gen_2_label(Bytecode opcode, Label label);
  * @param[in]   idprop
  *     the properties of the function or procedure identifier
  */
-void gen_call(char *fname, IDprop *idprop);
+void gen_call(Symbol fname, IDprop *idprop);
 
 /**
  * Generates the instructions that handle comparisons, ensuring that either
@@ -141,7 +142,8 @@ Label get_label(void);
 const char *get_opcode_string(Bytecode opcode);
 
 /**
- * Initialises the code generation unit.
+ * Initialises the code generation unit.  The interning pool must have been
+ * initialised.
  */
 void init_code_generation(void);
 
@@ -153,7 +155,7 @@ void init_code_generation(void);
  * @param[in]   p
  *     the properties of the function or procedure identifier
  */
-void init_subroutine_codegen(const char *name, IDprop *p);
+void init_subroutine_codegen(Symbol name, IDprop *p);
 
 /**
  * Prints the generated code to screen; for debugging purposes.
@@ -171,7 +173,7 @@ void make_code_file(void);
  *
  * @param[in] cname the name of the class file
  */
-void set_class_name(char *cname);
+void set_class_name(Symbol cname);
 
 /**
  * Releases the resources allocated or held by the code generation unit.
@@ -0,0 +1,235 @@
+/**
+ * @file    conctable.c
+ * @brief   A hash table that many threads may search while others insert into
+ *          it, with a lock per stripe of buckets.
+ *
+ * The size of the table is a power of two, no smaller than the number of
+ * stripes, so that the bucket of a hash code, masked by the size, falls in the
+ * stripe of the same hash code, masked by the number of stripes.  The bucket
+ * array, the mask, and the largest number of entries before the table grows,
+ * are only written with every stripe held for writing, so holding any one
+ * stripe is enough to read them.
+ *
+ * The number of entries is counted atomically, outside the stripes.  The thread
+ * whose insertion takes it beyond the load factor grows the table, once it has
+ * let go of its own stripe; it takes the stripes in order, so two threads that
+ * both try to grow the table cannot deadlock, and the second finds that there
+ * is nothing left to do.
+ */
+
+#include "conctable.h"
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "boolean.h"
+#include "error.h"
+
+/* --- type definitions and constants --------------------------------------- */
+
+#define INITIAL_SIZE CONC_TABLE_STRIPES
+#define STRIPE_MASK  (CONC_TABLE_STRIPES - 1)
+
+/* the stripe that guards the buckets of a hash code */
+#define STRIPE(ct, h) (&(ct)->stripes[(h) & STRIPE_MASK])
+
+/** a lock on a stripe, in a cache line of its own */
+typedef struct {
+	_Alignas(64)
+	pthread_rwlock_t lock;
+} Stripe;
+
+/** an entry of a chain */
+typedef struct ctentry {
+	void           *key;    /*<< the key                   */
+	void           *value;  /*<< the value                 */
+	unsigned int    hash;   /*<< the full hash code of key */
+	struct ctentry *next;   /*<< the next entry            */
+} CTentry;
+
+/** a concurrent hash table container */
+struct conctab {
+	/** the locks on the stripes of buckets                             */
+	Stripe         stripes[CONC_TABLE_STRIPES];
+	/** the buckets                                                     */
+	CTentry      **buckets;
+	/** the size of the bucket array, less one                          */
+	unsigned int   mask;
+	/** the number of entries beyond which the table grows              */
+	unsigned int   max_entries;
+	/** the number of entries                                           */
+	atomic_uint    num_entries;
+	/** the maximum load factor                                         */
+	float          max_loadfactor;
+	/** the hash function                                               */
+	unsigned int (*hash)(void *, unsigned int);
+	/** the key comparison function                                     */
+	int          (*cmp)(void *, void *);
+};
+
+/* --- function prototypes -------------------------------------------------- */
+
+static void grow(ConcTab *ct);
+static void set_buckets(ConcTab *ct, unsigned int size);
+
+/* --- concurrent hash table interface -------------------------------------- */
+
+ConcTab *ct_init(float loadfactor,
+				 unsigned int (*hash)(void *key, unsigned int size),
+				 int (*cmp)(void *val1, void *val2))
+{
+	ConcTab *ct;
+	unsigned int i;
+
+	/* the stripes must start cache lines, which malloc does not promise */
+	if ((ct = aligned_alloc(_Alignof(ConcTab), sizeof(ConcTab))) == NULL) {
+		eprintf("concurrent hash table could not be allocated:");
+	}
+	for (i = 0; i < CONC_TABLE_STRIPES; i++) {
+		if (pthread_rwlock_init(&ct->stripes[i].lock, NULL) != 0) {
+			eprintf("lock of a concurrent hash table could not be "
+					"initialised");
+		}
+	}
+	ct->max_loadfactor = loadfactor;
+	ct->hash = hash;
+	ct->cmp = cmp;
+	atomic_init(&ct->num_entries, 0);
+	set_buckets(ct, INITIAL_SIZE);
+
+	return ct;
+}
+
+int ct_insert(ConcTab *ct, void *key, void *value)
+{
+	unsigned int h = ct->hash(key, UINT_MAX), n;
+	Stripe *s = STRIPE(ct, h);
+	CTentry *e, **b;
+	Boolean full;
+
+	pthread_rwlock_wrlock(&s->lock);
+	b = &ct->buckets[h & ct->mask];
+	for (e = *b; e != NULL; e = e->next) {
+		if (e->hash == h && ct->cmp(e->key, key) == 0) {
+			pthread_rwlock_unlock(&s->lock);
+			return HASH_TABLE_KEY_VALUE_PAIR_EXISTS;
+		}
+	}
+	e = emalloc(sizeof(CTentry));
+	e->key = key;
+	e->value = value;
+	e->hash = h;
+	e->next = *b;
+	*b = e;
+	n = atomic_fetch_add_explicit(&ct->num_entries, 1, memory_order_relaxed);
+	full = (n + 1 > ct->max_entries);
+	pthread_rwlock_unlock(&s->lock);
+
+	if (full) {
+		grow(ct);
+	}
+
+	return EXIT_SUCCESS;
+}
+
+Boolean ct_search(ConcTab *ct, void *key, void **value)
+{
+	unsigned int h = ct->hash(key, UINT_MAX);
+	Stripe *s = STRIPE(ct, h);
+	CTentry *e;
+
+	pthread_rwlock_rdlock(&s->lock);
+	for (e = ct->buckets[h & ct->mask]; e != NULL; e = e->next) {
+		if (e->hash == h && ct->cmp(e->key, key) == 0) {
+			*value = e->value;
+			pthread_rwlock_unlock(&s->lock);
+			return TRUE;
+		}
+	}
+	pthread_rwlock_unlock(&s->lock);
+
+	return FALSE;
+}
+
+void ct_foreach(ConcTab *ct, void (*visit)(void *key, void *value, void *arg),
+				void *arg)
+{
+	CTentry *e;
+	unsigned int i;
+
+	for (i = 0; i <= ct->mask; i++) {
+		for (e = ct->buckets[i]; e != NULL; e = e->next) {
+			visit(e->key, e->value, arg);
+		}
+	}
+}
+
+void ct_free(ConcTab *ct, void (*freekey)(void *k), void (*freeval)(void *v))
+{
+	CTentry *e, *next;
+	unsigned int i;
+
+	for (i = 0; i <= ct->mask; i++) {
+		for (e = ct->buckets[i]; e != NULL; e = next) {
+			next = e->next;
+			if (freekey) {
+				freekey(e->key);
+			}
+			if (freeval) {
+				freeval(e->value);
+			}
+			free(e);
+		}
+	}
+	for (i = 0; i < CONC_TABLE_STRIPES; i++) {
+		pthread_rwlock_destroy(&ct->stripes[i].lock);
+	}
+	free(ct->buckets);
+	free(ct);
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+/* Doubles the size of the table, unless another thread has done so since the
+ * table was found to be full, or the table cannot grow any further. */
+static void grow(ConcTab *ct)
+{
+	CTentry **old, *e, *next;
+	unsigned int i, old_size;
+
+	for (i = 0; i < CONC_TABLE_STRIPES; i++) {
+		pthread_rwlock_wrlock(&ct->stripes[i].lock);
+	}
+
+	old_size = ct->mask + 1;
+	if (atomic_load_explicit(&ct->num_entries, memory_order_relaxed)
+			> ct->max_entries && old_size <= UINT_MAX / 2) {
+		old = ct->buckets;
+		set_buckets(ct, 2 * old_size);
+		for (i = 0; i < old_size; i++) {
+			for (e = old[i]; e != NULL; e = next) {
+				next = e->next;
+				e->next = ct->buckets[e->hash & ct->mask];
+				ct->buckets[e->hash & ct->mask] = e;
+			}
+		}
+		free(old);
+	}
+
+	for (i = CONC_TABLE_STRIPES; i > 0; i--) {
+		pthread_rwlock_unlock(&ct->stripes[i - 1].lock);
+	}
+}
+
+/* Allocates an empty bucket array of the specified size, and sets the mask and
+ * the largest number of entries to match. */
+static void set_buckets(ConcTab *ct, unsigned int size)
+{
+	ct->buckets = emalloc(size * sizeof(CTentry *));
+	memset(ct->buckets, 0, size * sizeof(CTentry *));
+	ct->mask = size - 1;
+	ct->max_entries = (unsigned int) (ct->max_loadfactor * size);
+}
@@ -0,0 +1,114 @@
+/**
+ * @file    conctable.h
+ * @brief   A hash table that many threads may search while others insert into
+ *          it.
+ *
+ * The table chains its entries, as hashtable.c does, and guards its buckets
+ * with a fixed number of reader-writer locks, or stripes: bucket i belongs to
+ * stripe i modulo the number of stripes.  A search takes the read lock of one
+ * stripe, and an insertion the write lock of one stripe, so that threads that
+ * touch different stripes never wait for one another, and searches never wait
+ * for searches.  The table only grows with all of the stripes held, and since
+ * its size stays a multiple of the number of stripes, the stripe of a key does
+ * not depend on the size.
+ *
+ * The keys and values are arbitrary, and the hash and comparison functions are
+ * those of <code>HashTab</code>.  Nothing is ever removed from the table while
+ * it is in use.
+ */
+
+#ifndef CONCTABLE_H
+#define CONCTABLE_H
+
+#include "boolean.h"
+#include "hashtable.h"
+
+/** the number of locks that guard the buckets; a power of two */
+#define CONC_TABLE_STRIPES 64
+
+/** the container structure for a concurrent hash table */
+typedef struct conctab ConcTab;
+
+/**
+ * Initialises a concurrent hash table.
+ *
+ * @param[in]   loadfactor
+ *     the maximum load factor, which, when reached, triggers a resize of the
+ *     underlying table
+ * @param[in]   hash
+ *     a hash function over the domain of the keys, as for
+ *     <code>ht_init</code>; the table reduces the full hash code to its size
+ *     by masking, so the low bits must be well mixed
+ * @param[in]   cmp
+ *     a function that compares two keys, returning <code>0</code> if they are
+ *     equal
+ * @return      a pointer to the table container structure
+ */
+ConcTab *ct_init(float loadfactor,
+				 unsigned int (*hash)(void *key, unsigned int size),
+				 int (*cmp)(void *val1, void *val2));
+
+/**
+ * Associates the specified key with the specified value in the specified
+ * table.  Any thread may call this at any time while the table is in use.
+ *
+ * @param[in]   ct
+ *     a pointer to the table in which to associate the key with the value
+ * @param[in]   key
+ *     a pointer to the key
+ * @param[in]   value
+ *     a pointer to the value
+ * @return      <code>EXIT_SUCCESS</code> if the insertion was successful, or
+ *              <code>HASH_TABLE_KEY_VALUE_PAIR_EXISTS</code> if the key is
+ *              already in the table
+ */
+int ct_insert(ConcTab *ct, void *key, void *value);
+
+/**
+ * Searches the specified table for the value associated with the specified
+ * key.  Any thread may call this at any time while the table is in use.
+ *
+ * @param[in]   ct
+ *     a pointer to the table in which to search for the key
+ * @param[in]   key
+ *     the key for which to find the associated value
+ * @param[out]  value
+ *     a pointer to the address of the variable where the value, if found, will
+ *     be copied
+ * @return      <code>TRUE</code> if the key was found, or <code>FALSE</code>
+ *              otherwise
+ */
+Boolean ct_search(ConcTab *ct, void *key, void **value);
+
+/**
+ * Calls the specified function on each entry of the specified table, in no
+ * particular order.  Only the thread that inserts into the table may call
+ * this, and only while no other thread does so.
+ *
+ * @param[in]   ct
+ *     a pointer to the table whose entries to visit
+ * @param[in]   visit
+ *     the function to call with the key and value of each entry, and the
+ *     specified argument
+ * @param[in]   arg
+ *     the argument passed on to the function
+ */
+void ct_foreach(ConcTab *ct, void (*visit)(void *key, void *value, void *arg),
+				void *arg);
+
+/**
+ * Releases the memory resources associated with the specified table, once no
+ * other thread uses it any longer.
+ *
+ * @param[in]   ct
+ *     a pointer to the table to release
+ * @param[in]   freekey
+ *     a pointer to a function that releases the memory resources of a key, or
+ *     <code>NULL</code>
+ * @param[in]   freeval
+ *     a pointer to a function that releases the memory resources of a value,
+ *     or <code>NULL</code>
+ */
+void ct_free(ConcTab *ct, void (*freekey)(void *k), void (*freeval)(void *v));
+
+#endif /* CONCTABLE_H */
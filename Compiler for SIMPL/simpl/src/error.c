@@ -13,6 +13,9 @@
 
 #include <errno.h>
 #include <stdarg.h>
+#ifdef COUNT_ALLOCATIONS
+#include <stdatomic.h>
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -88,6 +91,16 @@ static char *pname = NULL;
 #endif
 static char *sname = NULL;
 
+#ifdef COUNT_ALLOCATIONS
+/* the number of allocations made so far; the scanner threads allocate too */
+static atomic_ulong allocations;
+
+#define COUNT_ALLOCATION() \
+	atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed)
+#else
+#define COUNT_ALLOCATION()
+#endif
+
 static void _weprintf(const char *pre, const SourcePos *pos, const char *fmt,
 		va_list args)
 {
@@ -168,6 +181,7 @@ void teprintf(const char *tag, const char *fmt, ...)
 char *estrdup(const char *s)
 {
 	char *t;
+	COUNT_ALLOCATION();
 	t = malloc((strlen(s) + 1) * sizeof(char));
 	if (t == NULL)
 		eprintf("estrdup(\"%.20s\") failed:", s);
@@ -178,6 +192,7 @@ char *estrdup(const char *s)
 char *westrdup(const char *s)
 {
 	char *t;
+	COUNT_ALLOCATION();
 	t = malloc((strlen(s) + 1) * sizeof(char));
 	if (t == NULL)
 		weprintf("estrdup(\"%.20s\") failed:", s);
@@ -189,6 +204,7 @@ void *emalloc(size_t n)
 {
 	void *p;
 
+	COUNT_ALLOCATION();
 	p = malloc(n);
 	if (p == NULL)
 		eprintf("malloc of %u bytes failed:", n);
@@ -199,6 +215,7 @@ void *wemalloc(size_t n)
 {
 	void *p;
 
+	COUNT_ALLOCATION();
 	p = malloc(n);
 	if (p == NULL)
 		weprintf("malloc of %u bytes failed:", n);
@@ -209,6 +226,7 @@ void *erealloc(void *vp, size_t n)
 {
 	void *p;
 
+	COUNT_ALLOCATION();
 	p = realloc(vp, n);
 	if (p == NULL)
 		eprintf("realloc of %u bytes failed:", n);
@@ -219,12 +237,20 @@ void *werealloc(void *vp, size_t n)
 {
 	void *p;
 
+	COUNT_ALLOCATION();
 	p = realloc(vp, n);
 	if (p == NULL)
 		weprintf("realloc of %u bytes failed:", n);
 	return p;
 }
 
+#ifdef COUNT_ALLOCATIONS
+unsigned long get_allocation_count(void)
+{
+	return atomic_load_explicit(&allocations, memory_order_relaxed);
+}
+#endif
+
 #ifndef __APPLE__
 void setprogname(char *s)
 {
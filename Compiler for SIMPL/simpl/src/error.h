@@ -139,6 +139,18 @@ void *erealloc(void *vp, size_t n);
  */
 void *werealloc(void *vp, size_t n);
 
+#ifdef COUNT_ALLOCATIONS
+/**
+ * Returns the number of allocations and reallocations made through the
+ * functions above so far.  This is meant for measuring, for example, how many
+ * allocations the scanner makes per token, so the allocations are only counted
+ * if this file is compiled with COUNT_ALLOCATIONS defined.
+ *
+ * @return      the number of allocations so far
+ */
+unsigned long get_allocation_count(void);
+#endif
+
 /**
  * Frees the program name.
  */
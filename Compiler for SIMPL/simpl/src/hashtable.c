@@ -1,12 +1,39 @@
 /**
  * @file    hashtable.c
  * @brief   A generic hash table.
+ *
+ * When the table grows, its nodes move to the new buckets as they are; no node
+ * is allocated or freed.  If INCREMENTAL_REHASH is defined, the move is spread
+ * over the operations that follow it: the old buckets are kept beside the new
+ * ones, and each insertion or search moves a few more of them, so that no
+ * single operation pays for the whole table.  Until the move is over, a search
+ * that misses in the new buckets looks in the old ones as well.
+ *
+ * Each entry keeps the full hash code of its key, that is, the hash function's
+ * result for the largest possible size, which the table reduces to its own
+ * size.  A search calls the comparison function only for entries whose hash
+ * codes match, and a move places the entries without calling the hash function
+ * again.
+ *
+ * The entries are carved out of slabs that belong to the table, each twice the
+ * size of the one before, so that an insertion rarely allocates, and a table is
+ * released with a few calls to free, whatever the number of its entries.  The
+ * entries of deleted keys are kept on a free list, and handed out again before
+ * the slabs are.
+ *
+ * The sizes of the table are primes, so that even a weak hash function spreads
+ * the keys over the buckets.  If POWER_OF_TWO_TABLES is defined, the sizes are
+ * powers of two instead, and a hash code is reduced to a bucket with a mask
+ * rather than a division; the hash function must then mix its low bits well,
+ * as hash_bytes in bytehash.h does.
+ *
  * @author  W.H.K. Bester (whkbester@cs.sun.ac.za)
  * @date    2021-08-23
  */
 
 #include "hashtable.h"
 
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -15,23 +42,61 @@
 
 #define INITIAL_DELTA_INDEX 4
 #define PRINT_BUFFER_SIZE 1024
+#define INITIAL_SLAB_SIZE 8
+
+/* the size at an index into the delta array, and the bucket of a hash code */
+#ifdef POWER_OF_TWO_TABLES
+#define TABLE_SIZE(idx)  (1u << (idx))
+#define BUCKET(h, size)  ((h) & ((size) - 1))
+#else
+#define TABLE_SIZE(idx)  ((1u << (idx)) - delta[idx])
+#define BUCKET(h, size)  ((h) % (size))
+#endif
+
+/* the number of old buckets moved per operation while the table grows */
+#ifdef INCREMENTAL_REHASH
+#define REHASH_STEP 8
+#else
+#define REHASH_STEP UINT_MAX
+#endif
 
 /** an entry in the hash table */
 typedef struct htentry HTentry;
 struct htentry {
 	void *key;		   /*<< the key                      */
 	void *value;	   /*<< the value                    */
+	unsigned int hash; /*<< the full hash code of the key */
 	HTentry *next_ptr; /*<< the next entry in the bucket */
 };
 
+/** a block of entries */
+typedef struct htslab HTslab;
+struct htslab {
+	HTslab *next;		 /*<< the previously filled slab     */
+	unsigned int size;	 /*<< the number of entries it holds */
+	HTentry entries[];	 /*<< the entries                    */
+};
+
 /** a hash table container */
 struct hashtab {
 	/** a pointer to the underlying table                              */
 	HTentry **table;
 	/** the current size of the underlying table                       */
 	unsigned int size;
+	/** the table being moved into the underlying one, or NULL         */
+	HTentry **old_table;
+	/** the size of the old table                                      */
+	unsigned int old_size;
+	/** the number of old buckets moved so far                         */
+	unsigned int moved;
 	/** the current number of entries                                  */
 	unsigned int num_entries;
+	/** the slab being filled, or NULL                                 */
+	HTslab *slabs;
+	/** the number of entries used in the slab being filled            */
+	unsigned int slab_used;
+	/** the entries of deleted keys, linked through next_ptr           */
+	HTentry *free_entries;
 	/** the maximum load factor before the underlying table is resized */
 	float max_loadfactor;
 	/** the index into the delta array                                 */
@@ -40,6 +105,8 @@ struct hashtab {
 	unsigned int (*hash)(void *, unsigned int);
 	/** a pointer to the comparison function                           */
 	int (*cmp)(void *, void *);
+	/** the counters of the operations, if HASH_TABLE_STATS is defined */
+	HTstats counters;
 };
 
 /* --- function prototypes -------------------------------------------------- */
@@ -47,9 +114,12 @@ struct hashtab {
 /* TODO: For the following functions, refer to the TODO note at the end of the
  * file.
  */
-static int getsize(HashTab *ht);
 static HTentry **talloc(int tsize);
-static void rehash(HashTab *ht);
+static void rehash(HashTab *ht, unsigned short idx);
+static void move_buckets(HashTab *ht, unsigned int n);
+static HTentry *find_entry(HashTab *ht, void *key, unsigned int h);
+static HTentry *new_entry(HashTab *ht);
+static void add_chains(HTstats *stats, HTentry **table, unsigned int size);
 
 /* TODO: For this implementation, we want to ensure we *always* have a hash
  * table that is of prime size.  To that end, the next array stores the
@@ -74,17 +144,22 @@ HashTab *ht_init(float loadfactor, unsigned int (*hash)(void *, unsigned int),
 	/*unsigned int i;*/
 	ht = (HashTab *)malloc(sizeof(HashTab));
 	ht->idx = INITIAL_DELTA_INDEX;
-	ht->size = (1 << ht->idx) - delta[ht->idx];
-	ht->table = (HTentry **)malloc(sizeof(HTentry) * ht->size);
+	ht->size = TABLE_SIZE(ht->idx);
+	ht->table = (HTentry **)calloc(ht->size, sizeof(HTentry *));
 	if (ht == NULL || ht->table == NULL) {
 		free(ht->table);
 		free(ht);
 		return NULL;
 	}
+	ht->old_table = NULL;
+	ht->slabs = NULL;
+	ht->slab_used = 0;
+	ht->free_entries = NULL;
 	ht->num_entries = 0;
 	ht->max_loadfactor = loadfactor;
 	ht->hash = hash;
 	ht->cmp = cmp;
+	memset(&ht->counters, 0, sizeof(HTstats));
 
 	/* TODO:
 	 * - Initialise a hash table structure by calling an allocation function
@@ -103,38 +178,32 @@ HashTab *ht_init(float loadfactor, unsigned int (*hash)(void *, unsigned int),
 
 int ht_insert(HashTab *ht, void *key, void *value)
 {
-	int k;
-	HTentry *p, *h;
-	p = (HTentry *)malloc(sizeof(HTentry));
+	unsigned int h, k;
+	HTentry *p;
+
+	if (ht->old_table) {
+		move_buckets(ht, REHASH_STEP);
+	}
+	h = ht->hash(key, UINT_MAX);
+	if (find_entry(ht, key, h)) {
+		return HASH_TABLE_KEY_VALUE_PAIR_EXISTS;
+	}
+	p = new_entry(ht);
 	if (p == NULL) {
 		return HASH_TABLE_NO_SPACE_FOR_NODE;
 	}
-	k = ht->hash(key, ht->size);
+	k = BUCKET(h, ht->size);
 	p->key = key;
 	p->value = value;
-	p->next_ptr = NULL;
+	p->hash = h;
+	p->next_ptr = ht->table[k];
+	ht->table[k] = p;
 	ht->num_entries++;
 
-	if (ht->table[k] == NULL) {
-		ht->table[k] = p;
-	} else {
-		h = ht->table[k];
-		while (h) {
-			if (ht->cmp(h->key, p->key) == 0) {
-				return HASH_TABLE_KEY_VALUE_PAIR_EXISTS;
-			} else if (h->next_ptr == NULL) {
-				h->next_ptr = p;
-				break;
-			} else {
-				h = h->next_ptr;
-			}
-		}
-	}
-
 	float loadfactor = (float)ht->num_entries / (float)ht->size;
 	if (loadfactor > ht->max_loadfactor) {
 		/*printf("REHASH CALLED: ");*/
-		rehash(ht);
+		rehash(ht, ht->idx + 1);
 	}
 	return EXIT_SUCCESS;
 	/* TODO: Insert a new key--value pair, rehashing if necessary.  The best way
@@ -148,39 +217,146 @@ int ht_insert(HashTab *ht, void *key, void *value)
 
 Boolean ht_search(HashTab *ht, void *key, void **value)
 {
-	int k;
 	HTentry *p;
 
 	/* TODO: Nothing!  This function is complete, and should explain by example
 	 * how the hash table looks and must be accessed.
 	 */
 
-	k = ht->hash(key, ht->size);
-	for (p = ht->table[k]; p; p = p->next_ptr) {
-		if (ht->cmp(key, p->key) == 0) {
-			*value = p->value;
-			break;
-		}
+	if (ht->old_table) {
+		move_buckets(ht, REHASH_STEP);
+	}
+	if ((p = find_entry(ht, key, ht->hash(key, UINT_MAX)))) {
+		*value = p->value;
 	}
 
 	return (p ? TRUE : FALSE);
 }
 
-Boolean ht_free(HashTab *ht, void (*freekey)(void *k), void (*freeval)(void *v))
+Boolean ht_delete(HashTab *ht, void *key, void (*freekey)(void *k),
+				  void (*freeval)(void *v))
 {
-	unsigned int i;
-	HTentry *p /*, *q*/;
+	unsigned int h;
+	HTentry **pp, *p;
 
-	/* free the nodes in the buckets */
-	/* TODO */
-	for (i = 0; i < ht->size; i++) {
-		for (p = ht->table[i]; p != NULL; p = p->next_ptr) {
-			freekey(p->key);
-			freeval(p->value);
+	if (ht->old_table) {
+		move_buckets(ht, REHASH_STEP);
+	}
+	h = ht->hash(key, UINT_MAX);
+	for (pp = &ht->table[BUCKET(h, ht->size)];
+			*pp && ((*pp)->hash != h || ht->cmp(key, (*pp)->key) != 0);
+			pp = &(*pp)->next_ptr)
+		;
+	if (*pp == NULL && ht->old_table) {
+		for (pp = &ht->old_table[BUCKET(h, ht->old_size)];
+				*pp && ((*pp)->hash != h || ht->cmp(key, (*pp)->key) != 0);
+				pp = &(*pp)->next_ptr)
+			;
+	}
+	if ((p = *pp) == NULL) {
+		return FALSE;
+	}
+
+	*pp = p->next_ptr;
+	if (freekey) {
+		freekey(p->key);
+	}
+	if (freeval) {
+		freeval(p->value);
+	}
+	p->next_ptr = ht->free_entries;
+	ht->free_entries = p;
+	ht->num_entries--;
+
+	return TRUE;
+}
+
+int ht_reserve(HashTab *ht, unsigned int n)
+{
+	unsigned short idx;
+
+	for (idx = ht->idx; idx < MAX_IDX
+			&& (float) n / (float) TABLE_SIZE(idx) > ht->max_loadfactor; idx++)
+		;
+	if (idx == MAX_IDX) {
+		return HASH_TABLE_NO_SPACE_FOR_NODE;
+	}
+	if (idx > ht->idx) {
+		rehash(ht, idx);
+	}
+
+	return EXIT_SUCCESS;
+}
+
+void ht_iter_init(HashTab *ht, HTiter *it)
+{
+	/* every entry is visited in its final bucket */
+	if (ht->old_table) {
+		move_buckets(ht, UINT_MAX);
+	}
+	it->index = 0;
+	it->entry = NULL;
+}
+
+Boolean ht_iter_next(HashTab *ht, HTiter *it, void **key, void **value)
+{
+	HTentry *p;
+
+	while (it->entry == NULL && it->index < ht->size) {
+		it->entry = ht->table[it->index++];
+	}
+	if ((p = it->entry) == NULL) {
+		return FALSE;
+	}
+	it->entry = p->next_ptr;
+	if (key) {
+		*key = p->key;
+	}
+	if (value) {
+		*value = p->value;
+	}
+
+	return TRUE;
+}
+
+void ht_foreach(HashTab *ht, void (*visit)(void *k, void *v, void *arg),
+				void *arg)
+{
+	HTiter it;
+	void *k, *v;
+
+	ht_iter_init(ht, &it);
+	while (ht_iter_next(ht, &it, &k, &v)) {
+		visit(k, v, arg);
+	}
+}
+
+Boolean ht_free(HashTab *ht, void (*freekey)(void *k), void (*freeval)(void *v))
+{
+	HTiter it;
+	void *k, *v;
+	HTslab *s, *t;
+
+	/* the keys and values are released through the buckets, since the slabs
+	 * also hold the entries of deleted keys; the slabs then release the nodes
+	 * all at once */
+	if (freekey || freeval) {
+		ht_iter_init(ht, &it);
+		while (ht_iter_next(ht, &it, &k, &v)) {
+			if (freekey) {
+				freekey(k);
+			}
+			if (freeval) {
+				freeval(v);
+			}
 		}
 	}
+	for (s = ht->slabs; s != NULL; s = t) {
+		t = s->next;
+		free(s);
+	}
 	/* free the table and container */
-	/* TODO */
+	free(ht->old_table);
 	free(ht->table);
 	free(ht);
 
@@ -197,6 +373,11 @@ void ht_print(HashTab *ht, void (*keyval2str)(void *k, void *v, char *b))
 	 * write your own keyval2str function if you want to use it.
 	 */
 
+	/* show every entry in its final bucket */
+	if (ht->old_table) {
+		move_buckets(ht, UINT_MAX);
+	}
+
 	for (i = 0; i < ht->size; i++) {
 		printf("bucket[%2i]", i);
 		for (p = ht->table[i]; p != NULL; p = p->next_ptr) {
@@ -207,6 +388,17 @@ void ht_print(HashTab *ht, void (*keyval2str)(void *k, void *v, char *b))
 	}
 }
 
+void ht_stats(HashTab *ht, HTstats *stats)
+{
+	*stats = ht->counters;
+	stats->num_entries = ht->num_entries;
+	stats->size = ht->size;
+	add_chains(stats, ht->table, ht->size);
+	if (ht->old_table) {
+		add_chains(stats, ht->old_table, ht->old_size);
+	}
+}
+
 /* --- utility functions ---------------------------------------------------- */
 
 /* TODO: I suggest completing the following helper functions for use in the
@@ -217,60 +409,39 @@ void ht_print(HashTab *ht, void (*keyval2str)(void *k, void *v, char *b))
  * easier.
  */
 
-static int getsize(HashTab *ht)
-{
-	int i, new_size;
-	i = ht->idx + 1;
-	new_size = (1 << i) - delta[i];
-	return new_size;
-	/* TODO: Compute the next prime size of the hash table. */
-}
-
+/* Allocates a bucket array of the specified size in bytes, with every bucket
+ * empty. */
 static HTentry **talloc(int tsize)
 {
-	/* TODO: Allocate space for one hash table entry. */
-	return emalloc(tsize);
+	HTentry **t;
+
+	/* the buckets must start out empty; calloc can hand out large tables as
+	 * pages that are zeroed on first use, rather than clear them all now */
+	if ((t = calloc(1, tsize)) == NULL) {
+		eprintf("calloc of %d bytes failed:", tsize);
+	}
+	return t;
 }
 
-static void rehash(HashTab *ht)
+/* Grows the table to the size at the specified index into the delta array. */
+static void rehash(HashTab *ht, unsigned short idx)
 {
-	HashTab *rh;
-	HTentry *p;
-	p = malloc(sizeof(HTentry));
-	int i;
-	int old_size = ht->size;
-	rh = malloc(sizeof(HashTab));
-	int new_size = getsize(ht);
-	ht->idx = ht->idx + 1;
-	ht->size = new_size;
-	rh->table = talloc(sizeof(HTentry) * new_size);
-	rh->num_entries = 0;
-	rh->max_loadfactor = ht->max_loadfactor;
-	rh->idx = ht->idx;
-	rh->hash = ht->hash;
-	rh->cmp = ht->cmp;
-	rh->size = new_size;
-
-	for (i = 0; i < old_size; i++) {
-		for (p = ht->table[i]; p != NULL; p = p->next_ptr) {
-			int ret;
-			if ((ret = ht_insert(rh, p->key, p->value)) == EXIT_SUCCESS) {
-			}
-		}
+	/* a move still under way must end before the next can start */
+	if (ht->old_table) {
+		move_buckets(ht, UINT_MAX);
 	}
-
-	ht->table = talloc(sizeof(HTentry) * ht->size);
-
-	for (i = 0; i < new_size; i++) {
-		ht->table[i] = rh->table[i];
+	if (idx >= MAX_IDX) {
+		return;
 	}
 
-	free(rh->table);
-	free(rh);
-	/*printf("idx = %d\n", ht->idx);
-	printf("max_lf = %f\n", ht->max_loadfactor);
-	printf("num_entries = %d\n", ht->num_entries);
-	printf("size = %d\n", ht->size);*/
+	ht->old_table = ht->table;
+	ht->old_size = ht->size;
+	ht->moved = 0;
+	ht->size = TABLE_SIZE(idx);
+	ht->idx = idx;
+	ht->table = talloc(sizeof(HTentry *) * ht->size);
+	HT_COUNT(ht->counters, rehashes, 1);
+	move_buckets(ht, REHASH_STEP);
 
 	/* TODO: Rehash the hash table by
 	 * (1) allocating a new table that uses as size the next prime in the
@@ -280,3 +451,101 @@ static void rehash(HashTab *ht)
 	 * (3) freeing the old table.
 	 */
 }
+
+/* Moves the nodes of up to n more old buckets to the underlying table, and
+ * frees the old table once it is empty.  A move between two rehashes always
+ * ends in time, since the table must take on many more entries than it has old
+ * buckets before it grows again. */
+static void move_buckets(HashTab *ht, unsigned int n)
+{
+	unsigned int k;
+	HTentry *p, *q;
+
+	HT_COUNT(ht->counters, rehash_time, -ht_clock());
+	for (; n > 0 && ht->moved < ht->old_size; n--, ht->moved++) {
+		for (p = ht->old_table[ht->moved]; p != NULL; p = q) {
+			q = p->next_ptr;
+			k = BUCKET(p->hash, ht->size);
+			p->next_ptr = ht->table[k];
+			ht->table[k] = p;
+		}
+		ht->old_table[ht->moved] = NULL;
+	}
+	if (ht->moved == ht->old_size) {
+		free(ht->old_table);
+		ht->old_table = NULL;
+	}
+	HT_COUNT(ht->counters, rehash_time, ht_clock());
+}
+
+/* Returns the entry for the specified key, with the specified full hash code,
+ * in the underlying table or among the old buckets that have not been moved
+ * yet, or NULL if there is none. */
+static HTentry *find_entry(HashTab *ht, void *key, unsigned int h)
+{
+	HTentry *p;
+
+	HT_COUNT(ht->counters, lookups, 1);
+	for (p = ht->table[BUCKET(h, ht->size)]; p; p = p->next_ptr) {
+		HT_COUNT(ht->counters, comparisons, 1);
+		if (p->hash == h && ht->cmp(key, p->key) == 0) {
+			HT_COUNT(ht->counters, hits, 1);
+			return p;
+		}
+	}
+	if (ht->old_table) {
+		for (p = ht->old_table[BUCKET(h, ht->old_size)]; p; p = p->next_ptr) {
+			HT_COUNT(ht->counters, comparisons, 1);
+			if (p->hash == h && ht->cmp(key, p->key) == 0) {
+				HT_COUNT(ht->counters, hits, 1);
+				return p;
+			}
+		}
+	}
+	HT_COUNT(ht->counters, misses, 1);
+
+	return NULL;
+}
+
+/* Returns the entry of a deleted key, if there is one, or else a fresh entry
+ * from the slab being filled, starting a new slab, twice the size of the last,
+ * if it is full.  Returns NULL if there is no memory for it. */
+static HTentry *new_entry(HashTab *ht)
+{
+	HTslab *s;
+	HTentry *p;
+	unsigned int size;
+
+	if ((p = ht->free_entries) != NULL) {
+		ht->free_entries = p->next_ptr;
+		return p;
+	}
+	if (ht->slabs == NULL || ht->slab_used == ht->slabs->size) {
+		size = (ht->slabs ? 2 * ht->slabs->size : INITIAL_SLAB_SIZE);
+		if ((s = malloc(sizeof(HTslab) + size * sizeof(HTentry))) == NULL) {
+			return NULL;
+		}
+		s->next = ht->slabs;
+		s->size = size;
+		ht->slabs = s;
+		ht->slab_used = 0;
+	}
+
+	return &ht->slabs->entries[ht->slab_used++];
+}
+
+/* Records the chain of every entry in the buckets of the specified table.  An
+ * entry that has not been moved yet is counted from the start of its old
+ * bucket, although a search passes the new bucket first. */
+static void add_chains(HTstats *stats, HTentry **table, unsigned int size)
+{
+	unsigned int i;
+	unsigned long length;
+	HTentry *p;
+
+	for (i = 0; i < size; i++) {
+		for (p = table[i], length = 1; p != NULL; p = p->next_ptr, length++) {
+			ht_add_chain(stats, length);
+		}
+	}
+}
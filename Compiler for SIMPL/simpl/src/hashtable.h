@@ -9,8 +9,13 @@
 #ifndef HASH_TABLE_H
 #define HASH_TABLE_H
 
+#include <stdio.h>
 #include "boolean.h"
 
+#ifdef HASH_TABLE_STATS
+#include <time.h>
+#endif
+
 /* --- error return codes --------------------------------------------------- */
 
 #define HASH_TABLE_KEY_VALUE_PAIR_EXISTS -1
@@ -19,6 +24,58 @@
 /** the container structure for a hash table */
 typedef struct hashtab HashTab;
 
+/** a cursor over the entries of a hash table; see ht_iter_init */
+typedef struct {
+	unsigned int  index;  /*<< the next bucket or slot to look at          */
+	void         *entry;  /*<< the next entry of a chain, for chained tables */
+} HTiter;
+
+/* --- statistics ----------------------------------------------------------- */
+
+/** the number of chain lengths that the histogram tells apart */
+#define HASH_TABLE_HISTOGRAM_SIZE 8
+
+/**
+ * Statistics on a hash table.  The counters of the operations are only kept if
+ * the table is compiled with HASH_TABLE_STATS defined, and are zero otherwise;
+ * the shape of the table is taken when the statistics are asked for.
+ *
+ * The chain of an entry is what a successful search for it passes through:
+ * in a chained table, the entries of its bucket up to and including it; in an
+ * open-addressed table, the slots (or, for the Swiss table, the groups of
+ * slots) from its home slot up to its own.  The last bin of the histogram also
+ * counts all longer chains.
+ */
+typedef struct {
+	unsigned long lookups;      /*<< searches, including those of inserts  */
+	unsigned long hits;         /*<< searches that found their key         */
+	unsigned long misses;       /*<< searches that did not                 */
+	unsigned long comparisons;  /*<< entries or slots examined by searches */
+	unsigned long rehashes;     /*<< the number of times the table grew    */
+	double        rehash_time;  /*<< the seconds spent growing the table   */
+	unsigned long num_entries;  /*<< the number of entries                 */
+	unsigned long size;         /*<< the number of buckets or slots        */
+	unsigned long max_chain;    /*<< the length of the longest chain       */
+	unsigned long total_chain;  /*<< the sum of the lengths of all chains  */
+	/** the number of chains of length i + 1, in bin i                     */
+	unsigned long histogram[HASH_TABLE_HISTOGRAM_SIZE];
+} HTstats;
+
+/* the implementations count their operations through these macros; a time is
+ * counted by adding the clock negated at the start, and as is at the end */
+#ifdef HASH_TABLE_STATS
+#define HT_COUNT(stats, field, n) ((stats).field += (n))
+static inline double ht_clock(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+#else
+#define HT_COUNT(stats, field, n) ((void) 0)
+#endif
+
 /* --- function prototypes -------------------------------------------------- */
 
 /**
@@ -29,7 +86,9 @@ typedef struct hashtab HashTab;
  *     underlying table
  * @param[in]   hash
  *     a hash function over the domain of the keys, taking a pointer to the key
- *     and the size of the underlying table as parameters
+ *     and the size of the underlying table as parameters; the table calls it
+ *     with <code>UINT_MAX</code> as size, keeps the result as the full hash
+ *     code of the key, and reduces it to the size of the table itself
  * @param[in]   cmp
  *     a function that compares two values from the domain of values, returning
  *     <code>-1</code>, <code>0</code>, or <code>1</code> if <code>val1</code>
@@ -71,15 +130,98 @@ int ht_insert(HashTab *ht, void *key, void *value);
  */
 Boolean ht_search(HashTab *ht, void *key, void **value);
 
+/**
+ * Removes the entry for the specified key from the specified hash table.
+ *
+ * @param[in]   ht
+ *     a pointer to the hash table from which to remove the key
+ * @param[in]   key
+ *     the key to remove
+ * @param[in]   freekey
+ *     a pointer to a function that releases the memory resources of the key
+ *     stored in the table, or <code>NULL</code>
+ * @param[in]   freeval
+ *     a pointer to a function that releases the memory resources of the value,
+ *     or <code>NULL</code>
+ * @return      <code>TRUE</code> if the key was found and removed, or
+ *              <code>FALSE</code> otherwise
+ */
+Boolean ht_delete(HashTab *ht, void *key, void (*freekey)(void *k),
+				  void (*freeval)(void *v));
+
+/**
+ * Makes room in the specified hash table for the specified number of entries,
+ * so that the table does not grow again before it holds that many.  A table
+ * never shrinks, so if it already has room, nothing happens.
+ *
+ * @param[in]   ht
+ *     a pointer to the hash table to make room in
+ * @param[in]   n
+ *     the number of entries for which to make room, counting those already in
+ *     the table
+ * @return      <code>EXIT_SUCCESS</code> if there is room, or
+ *              <code>HASH_TABLE_NO_SPACE_FOR_NODE</code> if the table could not
+ *              be grown, in which case it is left as it was
+ */
+int ht_reserve(HashTab *ht, unsigned int n);
+
+/**
+ * Starts an iteration over the entries of the specified hash table, in no
+ * particular order.  The table must not be changed until the iteration ends.
+ *
+ * @param[in]   ht
+ *     a pointer to the hash table over which to iterate
+ * @param[out]  it
+ *     a pointer to the cursor to set to the start of the table
+ */
+void ht_iter_init(HashTab *ht, HTiter *it);
+
+/**
+ * Moves the specified cursor to the next entry of the specified hash table.
+ *
+ * @param[in]   ht
+ *     a pointer to the hash table over which to iterate
+ * @param[in,out] it
+ *     a pointer to the cursor, as set by <code>ht_iter_init</code>
+ * @param[out]  key
+ *     a pointer to the variable to which to copy the key of the entry, or
+ *     <code>NULL</code>
+ * @param[out]  value
+ *     a pointer to the variable to which to copy the value of the entry, or
+ *     <code>NULL</code>
+ * @return      <code>TRUE</code> if there was another entry, or
+ *              <code>FALSE</code> if the iteration is over
+ */
+Boolean ht_iter_next(HashTab *ht, HTiter *it, void **key, void **value);
+
+/**
+ * Calls the specified function on every entry of the specified hash table, in
+ * no particular order.  The function must not change the table.
+ *
+ * @param[in]   ht
+ *     a pointer to the hash table over which to iterate
+ * @param[in]   visit
+ *     a pointer to the function to call with the key and value of each entry,
+ *     and the specified argument
+ * @param[in]   arg
+ *     the argument to pass on to the function
+ */
+void ht_foreach(HashTab *ht, void (*visit)(void *k, void *v, void *arg),
+				void *arg);
+
 /**
  * Frees the space associated with the specified hash table.
  *
  * @param[in]   hashtable
  *     the hash table to free
  * @param[in]   freekey
- *     a pointer to a function that releases the memory resources of a key
+ *     a pointer to a function that releases the memory resources of a key, or
+ *     <code>NULL</code> if the keys are not owned by the table
  * @param[in]   freeval
- *     a pointer to a function that releases the memory resources of a value
+ *     a pointer to a function that releases the memory resources of a value,
+ *     or <code>NULL</code> if the values are not owned by the table; if both
+ *     are <code>NULL</code>, the entries are not visited at all, and the table
+ *     is released in a few calls to <code>free</code>
  * @return      <code>EXIT_SUCCESS</code> if the memory resources of the
  *              specified hash table were released successfully, or
  *              <code>EXIT_FAILURE</code> otherwise
@@ -100,4 +242,48 @@ Boolean ht_free(HashTab *ht,
  */
 void ht_print(HashTab *ht, void (*keyval2str)(void *k, void*v, char *b));
 
+/**
+ * Retrieves the statistics of the specified hash table.
+ *
+ * @param[in]   ht
+ *     the hash table whose statistics to retrieve
+ * @param[out]  stats
+ *     a pointer to the structure into which to copy the statistics
+ */
+void ht_stats(HashTab *ht, HTstats *stats);
+
+/**
+ * Adds the statistics of one table to those of others, so that the statistics
+ * of many tables can be reported as one.
+ *
+ * @param[in,out] total
+ *     the statistics to add to
+ * @param[in]   stats
+ *     the statistics to add
+ */
+void ht_add_stats(HTstats *total, const HTstats *stats);
+
+/**
+ * Prints the specified statistics on the specified stream.
+ *
+ * @param[in]   out
+ *     the stream on which to print the statistics
+ * @param[in]   title
+ *     the title under which to print them
+ * @param[in]   stats
+ *     the statistics to print
+ */
+void ht_print_stats(FILE *out, const char *title, const HTstats *stats);
+
+/**
+ * Records a chain of the specified length in the specified statistics.  The
+ * implementations call this as they take the shape of a table.
+ *
+ * @param[in,out] stats
+ *     the statistics to record the chain in
+ * @param[in]   length
+ *     the length of the chain, at least one
+ */
+void ht_add_chain(HTstats *stats, unsigned long length);
+
 #endif /* HASH_TABLE_H */
@@ -0,0 +1,76 @@
+/**
+ * @file    htstats.c
+ * @brief   Reporting of hash table statistics, common to all implementations
+ *          of hashtable.h.
+ */
+
+#include "hashtable.h"
+
+#include <stdio.h>
+
+/* --- hash table statistics ------------------------------------------------ */
+
+void ht_add_stats(HTstats *total, const HTstats *stats)
+{
+	unsigned int i;
+
+	total->lookups += stats->lookups;
+	total->hits += stats->hits;
+	total->misses += stats->misses;
+	total->comparisons += stats->comparisons;
+	total->rehashes += stats->rehashes;
+	total->rehash_time += stats->rehash_time;
+	total->num_entries += stats->num_entries;
+	total->size += stats->size;
+	if (stats->max_chain > total->max_chain) {
+		total->max_chain = stats->max_chain;
+	}
+	total->total_chain += stats->total_chain;
+	for (i = 0; i < HASH_TABLE_HISTOGRAM_SIZE; i++) {
+		total->histogram[i] += stats->histogram[i];
+	}
+}
+
+void ht_add_chain(HTstats *stats, unsigned long length)
+{
+	stats->histogram[length < HASH_TABLE_HISTOGRAM_SIZE
+			? length - 1 : HASH_TABLE_HISTOGRAM_SIZE - 1]++;
+	stats->total_chain += length;
+	if (length > stats->max_chain) {
+		stats->max_chain = length;
+	}
+}
+
+void ht_print_stats(FILE *out, const char *title, const HTstats *stats)
+{
+	unsigned long chains;
+	unsigned int i;
+
+	for (i = 0, chains = 0; i < HASH_TABLE_HISTOGRAM_SIZE; i++) {
+		chains += stats->histogram[i];
+	}
+
+	fprintf(out, "%s\n", title);
+	fprintf(out, "  entries      %10lu in %lu buckets (load %.2f)\n",
+			stats->num_entries, stats->size,
+			(stats->size ? (double) stats->num_entries / stats->size : 0.0));
+#ifdef HASH_TABLE_STATS
+	fprintf(out, "  lookups      %10lu (%lu hits, %lu misses)\n",
+			stats->lookups, stats->hits, stats->misses);
+	fprintf(out, "  comparisons  %10.2f per lookup\n",
+			(stats->lookups ? (double) stats->comparisons / stats->lookups
+			 : 0.0));
+	fprintf(out, "  rehashes     %10lu (%.6f s)\n", stats->rehashes,
+			stats->rehash_time);
+#else
+	fprintf(out, "  (compile with -DHASH_TABLE_STATS to count operations)\n");
+#endif
+	fprintf(out, "  chains       %10lu, longest %lu, mean %.2f\n", chains,
+			stats->max_chain,
+			(chains ? (double) stats->total_chain / chains : 0.0));
+	for (i = 0; i < HASH_TABLE_HISTOGRAM_SIZE; i++) {
+		fprintf(out, "  length %2u%-2s %10lu\n", i + 1,
+				(i + 1 < HASH_TABLE_HISTOGRAM_SIZE ? "" : "+"),
+				stats->histogram[i]);
+	}
+}
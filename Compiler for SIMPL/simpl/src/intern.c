@@ -0,0 +1,199 @@
+/**
+ * @file    intern.c
+ * @brief   An interning pool for the identifiers of SIMPL-2021.
+ *
+ * The names live in large blocks of characters that are never moved, so that
+ * the pointers handed out by <code>symbol_name</code> stay valid.  The symbols
+ * index an array of entries, and an open-addressing table of symbols, of
+ * power-of-two size and probed linearly, maps names to symbols.  Each slot of
+ * the table keeps the hash of its name next to the symbol, so that a probe only
+ * touches the entry (and the name) of a symbol whose hash matches.
+ */
+
+#include "intern.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "error.h"
+
+#define INITIAL_SLOTS    256
+#define INITIAL_ENTRIES  256
+#define NAME_BLOCK_SIZE  4096
+
+/** an interned identifier */
+typedef struct {
+	const char   *name;    /*<< the NUL-terminated name */
+	unsigned int  length;  /*<< the length of the name  */
+} SymEntry;
+
+/** a slot in the hash table */
+typedef struct {
+	unsigned int  hash;  /*<< the hash of the name, if the slot is used */
+	Symbol        sym;   /*<< the symbol, or NO_SYMBOL if unused        */
+} Slot;
+
+/** a block of storage for names */
+typedef struct nameblock NameBlock;
+struct nameblock {
+	NameBlock *next;    /*<< the previously filled block  */
+	size_t     used;    /*<< the number of characters used */
+	size_t     size;    /*<< the capacity of the block     */
+	char       data[];  /*<< the characters of the names   */
+};
+
+/* --- global static variables ---------------------------------------------- */
+
+static SymEntry     *entries;      /* the entries, indexed by symbol        */
+static unsigned int  num_entries;  /* the next symbol to hand out           */
+static unsigned int  max_entries;  /* the allocated size of entries         */
+static Slot         *slots;        /* the hash table of symbols             */
+static unsigned int  slot_mask;    /* the size of the hash table, less one  */
+static NameBlock    *names;        /* the block currently being filled      */
+
+/* --- function prototypes -------------------------------------------------- */
+
+static unsigned int hash_name(const char *s, size_t length);
+static const char *store_name(const char *s, size_t length);
+static void grow_slots(void);
+
+/* --- interning pool interface --------------------------------------------- */
+
+void init_intern(void)
+{
+	entries = emalloc(INITIAL_ENTRIES * sizeof(SymEntry));
+	max_entries = INITIAL_ENTRIES;
+	entries[NO_SYMBOL].name = "";
+	entries[NO_SYMBOL].length = 0;
+	num_entries = NO_SYMBOL + 1;
+	slots = emalloc(INITIAL_SLOTS * sizeof(Slot));
+	memset(slots, NO_SYMBOL, INITIAL_SLOTS * sizeof(Slot));
+	slot_mask = INITIAL_SLOTS - 1;
+	names = NULL;
+}
+
+Symbol intern(const char *s, size_t length)
+{
+	unsigned int h, i;
+	Symbol sym;
+	SymEntry *e;
+
+	h = hash_name(s, length);
+	for (i = h & slot_mask; (sym = slots[i].sym) != NO_SYMBOL;
+			i = (i + 1) & slot_mask) {
+		if (slots[i].hash == h) {
+			e = &entries[sym];
+			if (e->length == length && memcmp(e->name, s, length) == 0) {
+				return sym;
+			}
+		}
+	}
+
+	/* first sighting: add the name, and keep the table at most half full */
+	if (num_entries == max_entries) {
+		max_entries *= 2;
+		entries = erealloc(entries, max_entries * sizeof(SymEntry));
+	}
+	sym = num_entries++;
+	e = &entries[sym];
+	e->name = store_name(s, length);
+	e->length = length;
+	slots[i].hash = h;
+	slots[i].sym = sym;
+	if (2 * (num_entries - 1) > slot_mask) {
+		grow_slots();
+	}
+
+	return sym;
+}
+
+const char *symbol_name(Symbol sym)
+{
+	return entries[sym].name;
+}
+
+size_t symbol_length(Symbol sym)
+{
+	return entries[sym].length;
+}
+
+unsigned int num_symbols(void)
+{
+	return num_entries - 1;
+}
+
+void release_intern(void)
+{
+	NameBlock *b;
+
+	while ((b = names) != NULL) {
+		names = b->next;
+		free(b);
+	}
+	free(slots);
+	free(entries);
+	slots = NULL;
+	entries = NULL;
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+/* FNV-1a over the characters of the name */
+static unsigned int hash_name(const char *s, size_t length)
+{
+	unsigned int h = 2166136261u;
+	size_t i;
+
+	for (i = 0; i < length; i++) {
+		h ^= (unsigned char) s[i];
+		h *= 16777619u;
+	}
+
+	return h;
+}
+
+static const char *store_name(const char *s, size_t length)
+{
+	NameBlock *b;
+	size_t size;
+	char *name;
+
+	if (names == NULL || names->size - names->used < length + 1) {
+		size = (length + 1 > NAME_BLOCK_SIZE ? length + 1 : NAME_BLOCK_SIZE);
+		b = emalloc(sizeof(NameBlock) + size);
+		b->next = names;
+		b->used = 0;
+		b->size = size;
+		names = b;
+	}
+
+	name = names->data + names->used;
+	memcpy(name, s, length);
+	name[length] = '\0';
+	names->used += length + 1;
+
+	return name;
+}
+
+static void grow_slots(void)
+{
+	unsigned int i, j, new_mask;
+	Slot *new_slots;
+
+	new_mask = 2 * (slot_mask + 1) - 1;
+	new_slots = emalloc((new_mask + 1) * sizeof(Slot));
+	memset(new_slots, NO_SYMBOL, (new_mask + 1) * sizeof(Slot));
+
+	for (i = 0; i <= slot_mask; i++) {
+		if (slots[i].sym != NO_SYMBOL) {
+			for (j = slots[i].hash & new_mask;
+					new_slots[j].sym != NO_SYMBOL; j = (j + 1) & new_mask)
+				;
+			new_slots[j] = slots[i];
+		}
+	}
+
+	free(slots);
+	slots = new_slots;
+	slot_mask = new_mask;
+}
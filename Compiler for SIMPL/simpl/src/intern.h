@@ -0,0 +1,68 @@
+/**
+ * @file    intern.h
+ * @brief   An interning pool for the identifiers of SIMPL-2021.
+ *
+ * Every distinct identifier is stored once, and is represented everywhere else
+ * by a small integer, its symbol.  Two identifiers are equal if and only if
+ * their symbols are equal, so the scanner, the parser, the symbol table, and
+ * the code generator compare symbols rather than strings.
+ */
+
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stddef.h>
+
+/** the symbol of an interned identifier */
+typedef unsigned int Symbol;
+
+/** a value that is not the symbol of any identifier */
+#define NO_SYMBOL 0
+
+/**
+ * Initialises the interning pool.
+ */
+void init_intern(void);
+
+/**
+ * Returns the symbol of the specified identifier, adding the identifier to the
+ * pool if this is the first time it is seen.
+ *
+ * @param[in]   s
+ *     the characters of the identifier, which need not be NUL-terminated
+ * @param[in]   length
+ *     the number of characters in the identifier
+ * @return      the symbol of the identifier
+ */
+Symbol intern(const char *s, size_t length);
+
+/**
+ * Returns the name of the specified symbol.  The string is owned by the pool,
+ * and remains valid until the pool is released.
+ *
+ * @param[in]   sym
+ *     the symbol, as returned by <code>intern</code>
+ * @return      the NUL-terminated name of the symbol
+ */
+const char *symbol_name(Symbol sym);
+
+/**
+ * Returns the length of the name of the specified symbol.
+ *
+ * @param[in]   sym
+ *     the symbol, as returned by <code>intern</code>
+ * @return      the length of the name of the symbol
+ */
+size_t symbol_length(Symbol sym);
+
+/**
+ * Returns the number of distinct identifiers in the pool.
+ */
+unsigned int num_symbols(void);
+
+/**
+ * Releases the memory resources of the interning pool.
+ */
+void release_intern(void);
+
+#endif /* INTERN_H */
@@ -0,0 +1,200 @@
+/**
+ * @file    mkcorpus.c
+ * @brief   Generates synthetic SIMPL-2021 sources on which to measure the
+ *          scanner.
+ *
+ * The program writes a source of about the requested size to the standard
+ * output stream.  The body of the program consists of lines of one kind, or of
+ * a mix of them:
+ *
+ * - identifiers: assignments over many names of varying lengths,
+ * - strings: write statements with long strings, escape codes included,
+ * - comments: indented, multiline, and sometimes nested comments, and
+ * - numbers: arithmetic over literals of up to ten digits.
+ *
+ * The source scans without errors, although it is not meant to type check.
+ * The same arguments always give the same source, so that measurements can be
+ * compared from one build to the next.
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* --- type definitions and constants --------------------------------------- */
+
+typedef enum {
+	MIX_IDENTIFIERS, MIX_STRINGS, MIX_COMMENTS, MIX_NUMBERS, MIX_MIXED
+} Mix;
+
+static const char *mix_names[] = {
+	"identifiers", "strings", "comments", "numbers", "mixed"
+};
+
+#define NUM_MIXES    (sizeof(mix_names) / sizeof(mix_names[0]))
+#define NUM_NAMES    4096
+#define MAX_NAME_LEN 32
+
+static const char *words[] = {
+	"the", "scanner", "reads", "each", "character", "once", "and", "hands",
+	"tokens", "to", "parser", "which", "checks", "types", "before", "code",
+	"is", "generated", "for", "virtual", "machine"
+};
+
+#define NUM_WORDS    (sizeof(words) / sizeof(words[0]))
+
+/* --- global static variables ---------------------------------------------- */
+
+static unsigned long long rng_state;
+static char names[NUM_NAMES][MAX_NAME_LEN + 1];
+
+/* --- function prototypes -------------------------------------------------- */
+
+static unsigned int rnd(unsigned int n);
+static void make_names(void);
+static size_t write_identifiers(void);
+static size_t write_strings(void);
+static size_t write_comments(void);
+static size_t write_numbers(void);
+
+/* --- main routine --------------------------------------------------------- */
+
+int main(int argc, char *argv[])
+{
+	unsigned int mix;
+	size_t size, written;
+	char *end;
+
+	if (argc < 3 || argc > 4) {
+		fprintf(stderr, "usage: mkcorpus <identifiers | strings | comments | "
+				"numbers | mixed> <size> [<seed>]\n");
+		return EXIT_FAILURE;
+	}
+	for (mix = 0; mix < NUM_MIXES && strcmp(argv[1], mix_names[mix]) != 0;
+			mix++)
+		;
+	size = strtoul(argv[2], &end, 10);
+	if (mix == NUM_MIXES || *end != '\0' || size == 0) {
+		fprintf(stderr, "mkcorpus: bad mix or size\n");
+		return EXIT_FAILURE;
+	}
+	rng_state = (argc == 4 ? strtoull(argv[3], NULL, 10) : 0) * 2 + 1;
+
+	make_names();
+	written = (size_t) printf("program corpus\nbegin\n");
+	while (written < size) {
+		switch (mix == MIX_MIXED ? rnd(4) : mix) {
+			case MIX_IDENTIFIERS:
+				written += write_identifiers();
+				break;
+			case MIX_STRINGS:
+				written += write_strings();
+				break;
+			case MIX_COMMENTS:
+				written += write_comments();
+				break;
+			default:
+				written += write_numbers();
+		}
+	}
+	printf("  chill\nend\n");
+
+	return EXIT_SUCCESS;
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+/* a random number in [0, n), from a 64-bit linear congruential generator */
+static unsigned int rnd(unsigned int n)
+{
+	rng_state = rng_state * 6364136223846793005ull + 1442695040888963407ull;
+	return (unsigned int) ((rng_state >> 33) % n);
+}
+
+/* names of 1 to 32 characters, mostly short, none of them a reserved word */
+static void make_names(void)
+{
+	static const char first[] = "abcdefghijklmnopqrstuvwxyz"
+		"ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+	static const char rest[] = "abcdefghijklmnopqrstuvwxyz"
+		"ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_";
+	unsigned int i, j, len;
+
+	for (i = 0; i < NUM_NAMES; i++) {
+		len = (rnd(8) == 0 ? 1 + rnd(MAX_NAME_LEN) : 2 + rnd(10));
+		names[i][0] = first[rnd(sizeof(first) - 1)];
+		for (j = 1; j < len; j++) {
+			names[i][j] = rest[rnd(sizeof(rest) - 1)];
+		}
+		/* a final digit keeps the name clear of the reserved words, none of
+		 * which has fewer than two letters */
+		if (len > 1) {
+			names[i][len - 1] = (char) ('0' + i % 10);
+		}
+		names[i][len] = '\0';
+	}
+}
+
+static size_t write_identifiers(void)
+{
+	return (size_t) printf("  %s <- %s + %s * (%s - %s);\n",
+			names[rnd(NUM_NAMES)], names[rnd(NUM_NAMES)],
+			names[rnd(NUM_NAMES)], names[rnd(NUM_NAMES)],
+			names[rnd(NUM_NAMES)]);
+}
+
+static size_t write_strings(void)
+{
+	static const char *escapes[] = { "\\n", "\\t", "\\\"", "\\\\" };
+	size_t n;
+	unsigned int i, len;
+	int c;
+
+	n = (size_t) printf("  write \"");
+	len = 10 + rnd(100);
+	for (i = 0; i < len; i++) {
+		if (rnd(16) == 0) {
+			n += (size_t) printf("%s", escapes[rnd(4)]);
+		} else {
+			/* any printable character but the quote and the backslash */
+			do {
+				c = ' ' + (int) rnd(95);
+			} while (c == '"' || c == '\\');
+			putchar(c);
+			n++;
+		}
+	}
+	n += (size_t) printf("\";\n");
+
+	return n;
+}
+
+static size_t write_comments(void)
+{
+	size_t n;
+	unsigned int i, lines, len;
+
+	n = (size_t) printf("  (*");
+	lines = 1 + rnd(4);
+	while (lines-- > 0) {
+		len = 4 + rnd(12);
+		for (i = 0; i < len; i++) {
+			n += (size_t) printf(" %s", words[rnd(NUM_WORDS)]);
+		}
+		if (rnd(8) == 0) {
+			n += (size_t) printf(" (* nested * (remark) *)");
+		}
+		n += (size_t) printf("\n%*s", 4 + (int) rnd(8), "");
+	}
+	n += (size_t) printf("*)\n");
+
+	return n;
+}
+
+static size_t write_numbers(void)
+{
+	return (size_t) printf("  %s <- %u + %u * %u - %u;\n",
+			names[rnd(NUM_NAMES)], rnd(INT_MAX), rnd(1000), rnd(100000),
+			rnd(10));
+}
@@ -0,0 +1,158 @@
+/**
+ * @file    mkreserved.c
+ * @brief   Generates the perfect hash table for the reserved words of
+ *          SIMPL-2021.
+ *
+ * The scanner hashes a word incrementally as it reads the characters, using
+ * <code>h = h * RESERVED_HASH_MULT + c</code> over unsigned 32-bit integers,
+ * and takes the slot as <code>(h >> RESERVED_HASH_SHIFT) &
+ * RESERVED_HASH_MASK</code>.  This program searches for a multiplier and a
+ * shift for which every reserved word lands in a slot of its own, and writes
+ * the resulting table, as a C header, to the standard output stream.  A lookup
+ * therefore needs at most one string comparison.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* --- type definitions and constants --------------------------------------- */
+
+typedef struct {
+	const char *word;  /* the reserved word, i.e., the lexeme */
+	const char *type;  /* the name of the associated token type */
+} Keyword;
+
+/* reserved words */
+static Keyword keywords[] = {
+	{"and", "TOK_AND"}, {"array", "TOK_ARRAY"},
+	{"begin", "TOK_BEGIN"}, {"boolean", "TOK_BOOLEAN"},
+	{"chill", "TOK_CHILL"}, {"define", "TOK_DEFINE"},
+	{"do", "TOK_DO"}, {"else", "TOK_ELSE"},
+	{"elsif", "TOK_ELSIF"}, {"end", "TOK_END"},
+	{"exit", "TOK_EXIT"}, {"false", "TOK_FALSE"},
+	{"if", "TOK_IF"}, {"integer", "TOK_INTEGER"},
+	{"mod", "TOK_MOD"}, {"not", "TOK_NOT"},
+	{"or", "TOK_OR"}, {"program", "TOK_PROGRAM"},
+	{"read", "TOK_READ"}, {"then", "TOK_THEN"},
+	{"true", "TOK_TRUE"}, {"while", "TOK_WHILE"},
+	{"write", "TOK_WRITE"}
+};
+
+#define NUM_KEYWORDS   (sizeof(keywords) / sizeof(Keyword))
+#define MIN_TABLE_BITS 5
+#define MAX_TABLE_BITS 8
+#define MAX_MULT       (1u << 20)
+
+/* --- function prototypes -------------------------------------------------- */
+
+static unsigned int hash(const char *word, unsigned int mult);
+static int try_table(unsigned int bits, unsigned int mult, unsigned int shift,
+		int *slots);
+static void write_header(unsigned int bits, unsigned int mult,
+		unsigned int shift, int *slots);
+
+/* --- main routine --------------------------------------------------------- */
+
+int main(void)
+{
+	unsigned int bits, mult, shift;
+	int *slots;
+
+	for (bits = MIN_TABLE_BITS; bits <= MAX_TABLE_BITS; bits++) {
+		slots = malloc((1u << bits) * sizeof(int));
+		if (slots == NULL) {
+			fprintf(stderr, "mkreserved: out of memory\n");
+			return EXIT_FAILURE;
+		}
+		for (mult = 3; mult < MAX_MULT; mult += 2) {
+			for (shift = 0; shift <= 32 - bits; shift++) {
+				if (try_table(bits, mult, shift, slots)) {
+					write_header(bits, mult, shift, slots);
+					free(slots);
+					return EXIT_SUCCESS;
+				}
+			}
+		}
+		free(slots);
+	}
+
+	fprintf(stderr, "mkreserved: no perfect hash found\n");
+	return EXIT_FAILURE;
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+static unsigned int hash(const char *word, unsigned int mult)
+{
+	unsigned int h = 0;
+
+	while (*word) {
+		h = h * mult + (unsigned char) *word++;
+	}
+
+	return h;
+}
+
+static int try_table(unsigned int bits, unsigned int mult, unsigned int shift,
+		int *slots)
+{
+	unsigned int i, k, mask = (1u << bits) - 1;
+
+	for (i = 0; i <= mask; i++) {
+		slots[i] = -1;
+	}
+	for (i = 0; i < NUM_KEYWORDS; i++) {
+		k = (hash(keywords[i].word, mult) >> shift) & mask;
+		if (slots[k] >= 0) {
+			return 0;
+		}
+		slots[k] = (int) i;
+	}
+
+	return 1;
+}
+
+static void write_header(unsigned int bits, unsigned int mult,
+		unsigned int shift, int *slots)
+{
+	unsigned int i, len, min_len = ~0u, max_len = 0, first_chars = 0;
+
+	for (i = 0; i < NUM_KEYWORDS; i++) {
+		len = strlen(keywords[i].word);
+		min_len = (len < min_len ? len : min_len);
+		max_len = (len > max_len ? len : max_len);
+		first_chars |= 1u << (keywords[i].word[0] - 'a');
+	}
+
+	printf("/* reserved.h: generated by mkreserved -- do not edit */\n\n");
+	printf("#ifndef RESERVED_H\n#define RESERVED_H\n\n");
+	printf("#include \"token.h\"\n\n");
+	printf("typedef struct {\n"
+		   "\tconst char    *word;    /* the reserved word, i.e., the lexeme */\n"
+		   "\tunsigned char  length;  /* the length of the reserved word     */\n"
+		   "\tTokenType      type;    /* the associated token type          */\n"
+		   "} ReservedWord;\n\n");
+	printf("#define RESERVED_HASH_MULT   %uu\n", mult);
+	printf("#define RESERVED_HASH_SHIFT  %u\n", shift);
+	printf("#define RESERVED_HASH_MASK   0x%xu\n", (1u << bits) - 1);
+	printf("#define RESERVED_MIN_LENGTH  %u\n", min_len);
+	printf("#define RESERVED_MAX_LENGTH  %u\n", max_len);
+	printf("#define RESERVED_FIRST_CHARS 0x%07xu\n\n", first_chars);
+	printf("/* whether c may start a reserved word (all of them are lower case) */\n"
+		   "#define RESERVED_FIRST(c) \\\n"
+		   "\t((unsigned int) ((c) - 'a') < 26 \\\n"
+		   "\t && ((RESERVED_FIRST_CHARS >> ((c) - 'a')) & 1))\n\n");
+	printf("/* the reserved words, indexed by perfect hash slot */\n");
+	printf("static const ReservedWord reserved[%u] = {\n", 1u << bits);
+	for (i = 0; i < (1u << bits); i++) {
+		if (slots[i] >= 0) {
+			printf("\t{ \"%s\", %u, %s },\n", keywords[slots[i]].word,
+				   (unsigned int) strlen(keywords[slots[i]].word),
+				   keywords[slots[i]].type);
+		} else {
+			printf("\t{ NULL, 0, TOK_ID },\n");
+		}
+	}
+	printf("};\n\n#endif /* RESERVED_H */\n");
+}
@@ -0,0 +1,402 @@
+/**
+ * @file    robinhood.c
+ * @brief   A generic hash table, with open addressing and Robin Hood probing.
+ *
+ * This is an alternative to the separate chaining in hashtable.c, behind the
+ * same interface; the Makefile selects one of the two at build time.  The keys,
+ * values, and hash codes live in three parallel arrays, so that an insertion
+ * allocates nothing unless the table grows, and a lookup mostly walks the
+ * densely packed hash codes, looking at a key only when its hash code matches.
+ *
+ * An entry is placed at the first free slot at or after its home slot, but on
+ * the way there, it takes the place of any entry that lies closer to its own
+ * home slot, which then moves on in its stead.  This keeps the probe distances
+ * short and even, so that a search, which need not look further from home than
+ * the longest distance in the table, stops after a few slots.
+ *
+ * A deletion leaves no marker behind: the entries after the deleted one, up to
+ * the next empty slot or the next entry at home, each move back by one slot.
+ */
+
+#include "hashtable.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_DELTA_INDEX 4
+#define PRINT_BUFFER_SIZE 1024
+
+/* an open-addressed table cannot be full, so the load factor is capped here */
+#define MAX_LOADFACTOR 0.9f
+
+/* an empty slot; the stored hash codes are one more than the actual ones */
+#define EMPTY 0
+
+/** a hash table container */
+struct hashtab {
+	/** the keys of the slots                                          */
+	void **keys;
+	/** the values of the slots                                        */
+	void **values;
+	/** the hash codes of the slots, plus one, or EMPTY                */
+	unsigned int *hashes;
+	/** the current size of the underlying table                       */
+	unsigned int size;
+	/** the current number of entries                                  */
+	unsigned int num_entries;
+	/** the number of entries at which the table is resized            */
+	unsigned int max_entries;
+	/** the longest distance of any entry from its home slot           */
+	unsigned int max_dist;
+	/** the maximum load factor before the underlying table is resized */
+	float max_loadfactor;
+	/** the index into the delta array                                 */
+	unsigned short idx;
+	/** a pointer to the hash function                                 */
+	unsigned int (*hash)(void *, unsigned int);
+	/** a pointer to the comparison function                           */
+	int (*cmp)(void *, void *);
+	/** the counters of the operations, if HASH_TABLE_STATS is defined */
+	HTstats counters;
+};
+
+/* --- function prototypes -------------------------------------------------- */
+
+static Boolean talloc(HashTab *ht, unsigned short idx);
+static int rehash(HashTab *ht, unsigned short idx);
+static unsigned int find_slot(HashTab *ht, void *key, unsigned int h);
+static void place(HashTab *ht, unsigned int h, void *key, void *value);
+static unsigned int distance(HashTab *ht, unsigned int h, unsigned int slot);
+
+/** the array of differences between a power-of-two and the largest prime less
+ * than that power-of-two.                                                */
+static unsigned short delta[] = {
+	0,  0, 1, 1, 3, 1, 3, 1,  5, 3,  3, 9,  3,  1, 3,  19,
+	15, 1, 5, 1, 3, 9, 3, 15, 3, 39, 5, 39, 57, 3, 35, 1
+};
+
+#define MAX_IDX (sizeof(delta) / sizeof(short))
+
+/* --- hash table interface ------------------------------------------------- */
+
+HashTab *ht_init(float loadfactor, unsigned int (*hash)(void *, unsigned int),
+				 int (*cmp)(void *, void *))
+{
+	HashTab *ht;
+
+	if ((ht = malloc(sizeof(HashTab))) == NULL) {
+		return NULL;
+	}
+	ht->max_loadfactor = (loadfactor > 0.0f && loadfactor < MAX_LOADFACTOR
+			? loadfactor : MAX_LOADFACTOR);
+	if (!talloc(ht, INITIAL_DELTA_INDEX)) {
+		free(ht);
+		return NULL;
+	}
+	ht->num_entries = 0;
+	ht->hash = hash;
+	ht->cmp = cmp;
+	memset(&ht->counters, 0, sizeof(HTstats));
+
+	return ht;
+}
+
+int ht_insert(HashTab *ht, void *key, void *value)
+{
+	unsigned int h;
+
+	/* the size passed to the hash function is the largest possible one, so
+	 * that the hash code can be kept, and reduced again when the table grows */
+	h = ht->hash(key, UINT_MAX);
+	if (find_slot(ht, key, h) != ht->size) {
+		return HASH_TABLE_KEY_VALUE_PAIR_EXISTS;
+	}
+	/* if the table cannot grow, it fills up beyond the load factor */
+	if (ht->num_entries >= ht->max_entries
+			&& rehash(ht, ht->idx + 1) != EXIT_SUCCESS
+			&& ht->num_entries + 1 >= ht->size) {
+		return HASH_TABLE_NO_SPACE_FOR_NODE;
+	}
+
+	place(ht, h, key, value);
+	ht->num_entries++;
+
+	return EXIT_SUCCESS;
+}
+
+Boolean ht_search(HashTab *ht, void *key, void **value)
+{
+	unsigned int slot = find_slot(ht, key, ht->hash(key, UINT_MAX));
+
+	if (slot == ht->size) {
+		return FALSE;
+	}
+	*value = ht->values[slot];
+
+	return TRUE;
+}
+
+Boolean ht_delete(HashTab *ht, void *key, void (*freekey)(void *k),
+				  void (*freeval)(void *v))
+{
+	unsigned int slot, next;
+
+	if ((slot = find_slot(ht, key, ht->hash(key, UINT_MAX))) == ht->size) {
+		return FALSE;
+	}
+
+	if (freekey) {
+		freekey(ht->keys[slot]);
+	}
+	if (freeval) {
+		freeval(ht->values[slot]);
+	}
+	for (next = (slot + 1 == ht->size ? 0 : slot + 1);
+			ht->hashes[next] != EMPTY
+			&& distance(ht, ht->hashes[next] - 1, next) > 0;
+			slot = next, next = (next + 1 == ht->size ? 0 : next + 1)) {
+		ht->hashes[slot] = ht->hashes[next];
+		ht->keys[slot] = ht->keys[next];
+		ht->values[slot] = ht->values[next];
+	}
+	ht->hashes[slot] = EMPTY;
+	ht->num_entries--;
+
+	return TRUE;
+}
+
+int ht_reserve(HashTab *ht, unsigned int n)
+{
+	unsigned short idx;
+
+	for (idx = ht->idx; idx < MAX_IDX && (unsigned int) (ht->max_loadfactor
+			* ((1u << idx) - delta[idx])) < n; idx++)
+		;
+	if (idx == MAX_IDX) {
+		return HASH_TABLE_NO_SPACE_FOR_NODE;
+	}
+
+	return (idx > ht->idx ? rehash(ht, idx) : EXIT_SUCCESS);
+}
+
+void ht_iter_init(HashTab *ht, HTiter *it)
+{
+	(void) ht;
+	it->index = 0;
+	it->entry = NULL;
+}
+
+Boolean ht_iter_next(HashTab *ht, HTiter *it, void **key, void **value)
+{
+	while (it->index < ht->size && ht->hashes[it->index] == EMPTY) {
+		it->index++;
+	}
+	if (it->index == ht->size) {
+		return FALSE;
+	}
+	if (key) {
+		*key = ht->keys[it->index];
+	}
+	if (value) {
+		*value = ht->values[it->index];
+	}
+	it->index++;
+
+	return TRUE;
+}
+
+void ht_foreach(HashTab *ht, void (*visit)(void *k, void *v, void *arg),
+				void *arg)
+{
+	unsigned int i;
+
+	for (i = 0; i < ht->size; i++) {
+		if (ht->hashes[i] != EMPTY) {
+			visit(ht->keys[i], ht->values[i], arg);
+		}
+	}
+}
+
+Boolean ht_free(HashTab *ht, void (*freekey)(void *k), void (*freeval)(void *v))
+{
+	unsigned int i;
+
+	for (i = 0; (freekey || freeval) && i < ht->size; i++) {
+		if (ht->hashes[i] != EMPTY) {
+			if (freekey) {
+				freekey(ht->keys[i]);
+			}
+			if (freeval) {
+				freeval(ht->values[i]);
+			}
+		}
+	}
+	free(ht->keys);
+	free(ht->values);
+	free(ht->hashes);
+	free(ht);
+
+	return EXIT_SUCCESS;
+}
+
+void ht_print(HashTab *ht, void (*keyval2str)(void *k, void *v, char *b))
+{
+	unsigned int i;
+	char buffer[PRINT_BUFFER_SIZE];
+
+	/* each bucket holds at most one entry, as far from home as it has to be */
+	for (i = 0; i < ht->size; i++) {
+		printf("bucket[%2i]", i);
+		if (ht->hashes[i] != EMPTY) {
+			keyval2str(ht->keys[i], ht->values[i], buffer);
+			printf(" --> %s (+%u)", buffer,
+					distance(ht, ht->hashes[i] - 1, i));
+		}
+		printf(" --> NULL\n");
+	}
+}
+
+void ht_stats(HashTab *ht, HTstats *stats)
+{
+	unsigned int i;
+
+	*stats = ht->counters;
+	stats->num_entries = ht->num_entries;
+	stats->size = ht->size;
+	for (i = 0; i < ht->size; i++) {
+		if (ht->hashes[i] != EMPTY) {
+			ht_add_chain(stats, distance(ht, ht->hashes[i] - 1, i) + 1);
+		}
+	}
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+/* Allocates empty slots for the prime size at the specified index into the
+ * delta array, and returns whether it could. */
+static Boolean talloc(HashTab *ht, unsigned short idx)
+{
+	ht->idx = idx;
+	ht->size = (1u << idx) - delta[idx];
+	ht->max_entries = (unsigned int) (ht->max_loadfactor * ht->size);
+	ht->max_dist = 0;
+	ht->keys = malloc(ht->size * sizeof(void *));
+	ht->values = malloc(ht->size * sizeof(void *));
+	ht->hashes = calloc(ht->size, sizeof(unsigned int));
+	if (ht->keys == NULL || ht->values == NULL || ht->hashes == NULL) {
+		free(ht->keys);
+		free(ht->values);
+		free(ht->hashes);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Moves the entries to a table of the prime size at the specified index into
+ * the delta array.  The hash codes are kept, so neither the hash nor the
+ * comparison function is called. */
+static int rehash(HashTab *ht, unsigned short idx)
+{
+	void **keys = ht->keys, **values = ht->values;
+	unsigned int *hashes = ht->hashes, size = ht->size, i;
+	unsigned int max_entries = ht->max_entries, max_dist = ht->max_dist;
+	unsigned short old_idx = ht->idx;
+
+	if (idx >= MAX_IDX || !talloc(ht, idx)) {
+		/* leave the table as it was */
+		ht->keys = keys;
+		ht->values = values;
+		ht->hashes = hashes;
+		ht->size = size;
+		ht->max_entries = max_entries;
+		ht->max_dist = max_dist;
+		ht->idx = old_idx;
+		return HASH_TABLE_NO_SPACE_FOR_NODE;
+	}
+
+	HT_COUNT(ht->counters, rehash_time, -ht_clock());
+	for (i = 0; i < size; i++) {
+		if (hashes[i] != EMPTY) {
+			place(ht, hashes[i] - 1, keys[i], values[i]);
+		}
+	}
+	free(keys);
+	free(values);
+	free(hashes);
+	HT_COUNT(ht->counters, rehashes, 1);
+	HT_COUNT(ht->counters, rehash_time, ht_clock());
+
+	return EXIT_SUCCESS;
+}
+
+/* Returns the slot of the key with the specified hash code, or the size of the
+ * table if there is none.  No entry lies further from home than max_dist, which
+ * is cheaper to check than the distances of the entries along the way. */
+static unsigned int find_slot(HashTab *ht, void *key, unsigned int h)
+{
+	unsigned int slot, d;
+
+	HT_COUNT(ht->counters, lookups, 1);
+	slot = h % ht->size;
+	for (d = 0; d <= ht->max_dist && ht->hashes[slot] != EMPTY; d++) {
+		HT_COUNT(ht->counters, comparisons, 1);
+		if (ht->hashes[slot] == h + 1 && ht->cmp(key, ht->keys[slot]) == 0) {
+			HT_COUNT(ht->counters, hits, 1);
+			return slot;
+		}
+		if (++slot == ht->size) {
+			slot = 0;
+		}
+	}
+	HT_COUNT(ht->counters, misses, 1);
+
+	return ht->size;
+}
+
+/* Places an entry, known not to be in the table, in the first free slot from
+ * its home slot on, displacing entries that are closer to their home slots. */
+static void place(HashTab *ht, unsigned int h, void *key, void *value)
+{
+	unsigned int slot, d, e, th;
+	void *tk, *tv;
+
+	slot = h % ht->size;
+	for (d = 0; ht->hashes[slot] != EMPTY; d++) {
+		if ((e = distance(ht, ht->hashes[slot] - 1, slot)) < d) {
+			/* the resident is better off than the newcomer: swap them */
+			th = ht->hashes[slot] - 1;
+			tk = ht->keys[slot];
+			tv = ht->values[slot];
+			ht->hashes[slot] = h + 1;
+			ht->keys[slot] = key;
+			ht->values[slot] = value;
+			if (d > ht->max_dist) {
+				ht->max_dist = d;
+			}
+			h = th;
+			key = tk;
+			value = tv;
+			d = e;
+		}
+		if (++slot == ht->size) {
+			slot = 0;
+		}
+	}
+	ht->hashes[slot] = h + 1;
+	ht->keys[slot] = key;
+	ht->values[slot] = value;
+	if (d > ht->max_dist) {
+		ht->max_dist = d;
+	}
+}
+
+/* the distance of the specified slot from the home slot of the hash code */
+static unsigned int distance(HashTab *ht, unsigned int h, unsigned int slot)
+{
+	unsigned int home = h % ht->size;
+
+	return (slot >= home ? slot - home : slot + ht->size - home);
+}
@@ -6,410 +6,1125 @@
  */
 
 #include "scanner.h"
-#include <ctype.h>
 #include <limits.h>
+#include <pthread.h>
+#include <setjmp.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "boolean.h"
+#include "charscan.h"
 #include "error.h"
+#include "intern.h"
+#include "reserved.h"
 #include "token.h"
+#include "tokenring.h"
 
-/* --- type definitions and constants --------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+/* The source buffer is shared, but every thread that scans it has its own
+ * place in it: the characters and offsets that move as tokens are scanned are
+ * thread-local.
+ */
+static FILE *src_file;						/* the source file pointer		 */
+static _Thread_local int ch;				/* the next source character	 */
+static _Thread_local size_t token_start;	/* the start of the last token	 */
+
+/* When the source is a regular file, the whole of it is mapped into memory (or,
+ * if mapping fails, read in one go), and the scanner walks an index over the
+ * buffer.  Otherwise, for example, for pipes, the source is streamed through
+ * two fixed-size chunks, which are filled in turn: when the scanner runs off
+ * the end of one chunk, the other is refilled and becomes the buffer.  In both
+ * cases, src_pos is the index in src_buf of the character after ch, and
+ * src_base is the offset of src_buf in the source, so that tokens can record
+ * where in the source their lexemes lie.
+ */
+static char *src_buf;		/* the source buffer, or the current chunk	 */
+static size_t src_size;		/* the number of characters in src_buf		 */
+static _Thread_local size_t src_pos;	/* the index in src_buf just past ch	 */
+static size_t src_base;		/* the offset of src_buf in the source		 */
+static Boolean src_mapped;	/* whether src_buf was obtained by mmap		 */
+static Boolean src_stream;	/* whether the source is streamed in chunks	 */
+static Boolean src_eof;		/* whether the stream has been exhausted	 */
+
+static char *chunk[2];		/* the chunks, when streaming				 */
+static size_t chunk_base[2];	/* the offsets of the chunks in the source	 */
+static int curr_chunk;		/* the index of the chunk in src_buf		 */
+
+/* Since the previous chunk is only overwritten when the scanner moves on from
+ * the current one, the lexeme of the last token can be handed out straight
+ * from the chunks, unless it straddles the two.  An identifier or string that
+ * is still being scanned when a chunk runs out is therefore spilled: the part
+ * scanned so far is copied to lexbuf, and the rest is appended to it as it is
+ * read.  The buffer is reused from token to token, and only grows when a
+ * lexeme does not fit.
+ */
+static char *lexbuf;		/* the spilled lexeme of the last token		 */
+static size_t lexbuf_size;	/* the allocated size of lexbuf				 */
+static size_t lexbuf_len;	/* the length of the lexeme in lexbuf		 */
+static size_t lex_offset;	/* the offset of the lexeme being collected	 */
+static Boolean lex_open;	/* whether a lexeme is being collected		 */
+static Boolean lex_spilled;	/* whether the last lexeme is in lexbuf		 */
+
+/* Source positions are not tracked while scanning.  Instead, the offsets at
+ * which lines start are recorded in line_starts, and an offset is turned into
+ * a line and column only when an error has to be reported.  For a buffer, the
+ * table is filled lazily, up to the offset asked about.  A stream cannot be
+ * revisited, and a table of all its lines would grow with the input, so only
+ * the number and the start of the current line are kept, and they are updated
+ * whenever the scanner passes a newline.
+ */
+static size_t *line_starts;	/* the offsets at which the lines start	 */
+static size_t num_lines;	/* the number of lines recorded			 */
+static size_t max_lines;	/* the allocated size of line_starts	 */
+static size_t lines_indexed;	/* the offset up to which lines are known */
 
+/* When scanning runs ahead of the parser, get_token takes the tokens from a
+ * ring buffer, filled by a scanner thread, or from an array, filled up front by
+ * several threads that each scan a slice of the source.  A thread that scans
+ * ahead does not report errors: it jumps back to the top of its loop, leaves a
+ * failed slot, and stops.  When the parser reaches that slot, get_token scans
+ * the token again, on the parser's thread, and the error is reported exactly
+ * as it would have been without scanning ahead.  Nor are identifiers interned
+ * ahead, since the parser interns names of its own; get_token interns them as
+ * it hands them out.
+ */
+static Boolean ahead;		/* whether get_token hands out slots		 */
+static Boolean threaded;	/* whether the slots come from the ring		 */
+static pthread_t scan_thread;	/* the scanner thread					 */
+static TokenRing *ring;		/* the tokens scanned ahead, one by one		 */
+static TokenSlot *scanned;	/* the tokens scanned up front				 */
+static size_t num_scanned;	/* the number of slots in scanned			 */
+static size_t max_scanned;	/* the allocated number of slots in scanned	 */
+static size_t next_scanned;	/* the index of the next slot in scanned	 */
+static size_t ahead_from;	/* where the scanner thread starts			 */
+static size_t slot_start;	/* the start of the last token handed out	 */
+static size_t slot_end;		/* the end of the last token handed out		 */
+static _Thread_local Boolean deferring;	/* whether errors are left for later */
+static _Thread_local jmp_buf scan_abort;	/* where to go on a deferred error	 */
+static _Thread_local size_t resume_offset;	/* where the scan of a token began */
+
+/* For a parallel scan, the source is cut into slices at line starts, and each
+ * slice is scanned by a thread of its own, as if it were the start of the
+ * source.  A slice may, however, start inside a comment that began in an
+ * earlier one, so its tokens are only trusted from the first token at which the
+ * scan of the slices before it lands.  Since the scanner carries no state from
+ * one token to the next, everything from such a token on is exactly what a
+ * sequential scan would have produced; if the scans never meet, the slice is
+ * scanned again, on the calling thread, until they do.
+ */
 typedef struct {
-	char *word;		/* the reserved word, i.e., the lexeme */
-	TokenType type; /* the associated token type		   */
-} ReservedWord;
+	size_t     begin;	/* the offset at which the slice starts		 */
+	size_t     end;		/* the offset just past the slice			 */
+	TokenSlot *slots;	/* the tokens that start in the slice		 */
+	size_t     count;	/* the number of slots						 */
+	size_t     size;	/* the allocated number of slots			 */
+	size_t     exit;	/* the start of the first token past the end */
+	pthread_t  thread;	/* the thread that scans the slice			 */
+} Slice;
 
-/* -------------------------------------------------------------------------- */
+#define MAX_INITIAL_STRLEN (1024)
+#define INITIAL_LINES      (1024)
+#define CHUNK_SIZE         (256 * 1024)
+#define MAX_SLICES         (64)
+#define MIN_SLICE_SIZE     (64 * 1024)
 
-static FILE *src_file;	  /* the source file pointer			 */
-static int ch;			  /* the next source character			 */
-static int column_number; /* the current column number			 */
-
-/* reserved words */
-static ReservedWord reserved[] = {
-	{"and", TOK_AND}, {"array", TOK_ARRAY},
-	{"begin", TOK_BEGIN}, {"boolean", TOK_BOOLEAN},
-	{"chill", TOK_CHILL}, {"define", TOK_DEFINE},
-	{"do", TOK_DO},	{"else", TOK_ELSE},
-	{"elsif", TOK_ELSIF}, {"end", TOK_END},
-	{"exit", TOK_EXIT}, {"false", TOK_FALSE},
-	{"if", TOK_IF},	{"integer", TOK_INTEGER},
-	{"mod", TOK_MOD}, {"not", TOK_NOT},
-	{"or", TOK_OR},	{"program", TOK_PROGRAM},
-	{"read", TOK_READ}, {"then", TOK_THEN},
-	{"true", TOK_TRUE}, {"while", TOK_WHILE},
-	{"write", TOK_WRITE}
-	/* TODO: Populate this array with the appropriate pairs of reserved word
-	 * strings and token types, sorted alphabetically by reserved word string.
-	 */
+/* the offset of ch in the source; at the end of the source, ch is EOF, and its
+ * offset is that of the end of the source */
+#define CH_OFFSET (src_base + src_pos - (ch != EOF))
+
+/* note that ch, a newline, is about to be passed; a buffer is indexed lazily */
+#define PASS_NEWLINE()                              \
+	do {                                            \
+		if (src_stream) {                           \
+			num_lines++;                            \
+			line_starts[0] = CH_OFFSET + 1;         \
+		}                                           \
+	} while (0)
+
+/* move ch forward by n characters of the buffer at once */
+#define ADVANCE(n)                                  \
+	do {                                            \
+		src_pos += (n);                             \
+		ch = (unsigned char) src_buf[src_pos - 1];  \
+	} while (0)
+
+/* when scanning ahead, leave a scanner error for get_token to report */
+#define DEFER_ERROR()                \
+	do {                             \
+		if (deferring) {             \
+			longjmp(scan_abort, 1);  \
+		}                            \
+	} while (0)
+
+/* start and end collecting a lexeme; a buffer holds all lexemes already, and
+ * may be shared by several threads, so there is nothing to do for it */
+#define BEGIN_LEXEME()           \
+	do {                         \
+		if (src_stream) {        \
+			begin_lexeme();      \
+		}                        \
+	} while (0)
+
+#define END_LEXEME()             \
+	do {                         \
+		if (src_stream) {        \
+			lex_open = FALSE;    \
+		}                        \
+	} while (0)
+
+/* keep ch as part of the current lexeme, if the lexeme has been spilled */
+#define KEEP_CHAR()              \
+	do {                         \
+		if (lex_spilled) {       \
+			keep_char(ch);       \
+		}                        \
+	} while (0)
+
+/* --- character classes and the token DFA ---------------------------------- */
+
+/* The character classes.  Every operator character has a class of its own, so
+ * that the DFA below can tell them apart without looking at the character
+ * again.  CC_ILLEGAL must be zero, so that characters not mentioned in the
+ * class table, including the (unsigned char) cast of EOF, are illegal.
+ */
+typedef enum {
+	CC_ILLEGAL, CC_SPACE, CC_LETTER, CC_DIGIT, CC_QUOTE, CC_EQ, CC_GT, CC_LT,
+	CC_HASH, CC_MINUS, CC_PLUS, CC_SLASH, CC_STAR, CC_PERCENT, CC_AMPERSAND,
+	CC_LBRACK, CC_RBRACK, CC_COMMA, CC_LPAR, CC_RPAR, CC_SEMICOLON,
+	NUM_CLASSES
+} CharClass;
+
+#define CHAR_CLASS(c)   (char_class[(unsigned char) (c)])
+#define IS_WORD_CHAR(c) (CHAR_CLASS(c) == CC_LETTER || CHAR_CLASS(c) == CC_DIGIT)
+
+/* the class of every character in the (C locale) character set */
+static const unsigned char char_class[256] = {
+	['\t'] = CC_SPACE, ['\n'] = CC_SPACE, ['\v'] = CC_SPACE, ['\f'] = CC_SPACE,
+	['\r'] = CC_SPACE, [' ']  = CC_SPACE,
+
+	['A'] = CC_LETTER, ['B'] = CC_LETTER, ['C'] = CC_LETTER, ['D'] = CC_LETTER,
+	['E'] = CC_LETTER, ['F'] = CC_LETTER, ['G'] = CC_LETTER, ['H'] = CC_LETTER,
+	['I'] = CC_LETTER, ['J'] = CC_LETTER, ['K'] = CC_LETTER, ['L'] = CC_LETTER,
+	['M'] = CC_LETTER, ['N'] = CC_LETTER, ['O'] = CC_LETTER, ['P'] = CC_LETTER,
+	['Q'] = CC_LETTER, ['R'] = CC_LETTER, ['S'] = CC_LETTER, ['T'] = CC_LETTER,
+	['U'] = CC_LETTER, ['V'] = CC_LETTER, ['W'] = CC_LETTER, ['X'] = CC_LETTER,
+	['Y'] = CC_LETTER, ['Z'] = CC_LETTER,
+	['a'] = CC_LETTER, ['b'] = CC_LETTER, ['c'] = CC_LETTER, ['d'] = CC_LETTER,
+	['e'] = CC_LETTER, ['f'] = CC_LETTER, ['g'] = CC_LETTER, ['h'] = CC_LETTER,
+	['i'] = CC_LETTER, ['j'] = CC_LETTER, ['k'] = CC_LETTER, ['l'] = CC_LETTER,
+	['m'] = CC_LETTER, ['n'] = CC_LETTER, ['o'] = CC_LETTER, ['p'] = CC_LETTER,
+	['q'] = CC_LETTER, ['r'] = CC_LETTER, ['s'] = CC_LETTER, ['t'] = CC_LETTER,
+	['u'] = CC_LETTER, ['v'] = CC_LETTER, ['w'] = CC_LETTER, ['x'] = CC_LETTER,
+	['y'] = CC_LETTER, ['z'] = CC_LETTER, ['_'] = CC_LETTER,
+
+	['0'] = CC_DIGIT, ['1'] = CC_DIGIT, ['2'] = CC_DIGIT, ['3'] = CC_DIGIT,
+	['4'] = CC_DIGIT, ['5'] = CC_DIGIT, ['6'] = CC_DIGIT, ['7'] = CC_DIGIT,
+	['8'] = CC_DIGIT, ['9'] = CC_DIGIT,
+
+	['"'] = CC_QUOTE,     ['='] = CC_EQ,        ['>'] = CC_GT,
+	['<'] = CC_LT,        ['#'] = CC_HASH,      ['-'] = CC_MINUS,
+	['+'] = CC_PLUS,      ['/'] = CC_SLASH,     ['*'] = CC_STAR,
+	['%'] = CC_PERCENT,   ['&'] = CC_AMPERSAND, ['['] = CC_LBRACK,
+	[']'] = CC_RBRACK,    [','] = CC_COMMA,     ['('] = CC_LPAR,
+	[')'] = CC_RPAR,      [';'] = CC_SEMICOLON
 };
 
-#define NUM_RESERVED_WORDS (sizeof(reserved) / sizeof(ReservedWord))
-#define MAX_INITIAL_STRLEN (1024)
+/* The DFA states.  Apart from the start state, a state remembers a character
+ * that may be the first of a two-character operator.
+ */
+typedef enum {
+	ST_START,	/* at the first character of a token */
+	ST_LT,		/* after '<' */
+	ST_GT,		/* after '>' */
+	ST_MINUS,	/* after '-' */
+	ST_LPAR,	/* after '(' */
+	NUM_STATES
+} State;
+
+/* The DFA actions.  ACT_PENDING must be zero, so that unlisted moves out of a
+ * state other than the start state accept the token pending in that state,
+ * without consuming the current character.
+ */
+typedef enum {
+	ACT_PENDING,	/* accept pending[state]; do not consume    */
+	ACT_SHIFT,		/* consume, and move to state arg           */
+	ACT_ACCEPT,		/* consume, and accept token type arg       */
+	ACT_WORD,		/* scan a reserved word or identifier       */
+	ACT_NUMBER,		/* scan a number literal                    */
+	ACT_STRING,		/* consume the quote, and scan a string     */
+	ACT_COMMENT,	/* skip a comment, and start over           */
+	ACT_ILLEGAL		/* report an illegal character              */
+} Action;
+
+typedef struct {
+	unsigned char action;	/* what to do on the current character */
+	unsigned char arg;		/* the next state, or the token type   */
+} Move;
+
+#define SHIFT(s)  { ACT_SHIFT, (s) }
+#define ACCEPT(t) { ACT_ACCEPT, (t) }
+#define DO(a)     { (a), 0 }
+
+/* the token accepted when a state cannot be extended */
+static const TokenType pending[NUM_STATES] = {
+	TOK_EOF, TOK_LT, TOK_GT, TOK_MINUS, TOK_LPAR
+};
+
+/* the transition table, indexed by state and character class */
+static const Move dfa[NUM_STATES][NUM_CLASSES] = {
+	[ST_START] = {
+		[CC_ILLEGAL]   = DO(ACT_ILLEGAL),   [CC_SPACE]     = DO(ACT_ILLEGAL),
+		[CC_LETTER]    = DO(ACT_WORD),      [CC_DIGIT]     = DO(ACT_NUMBER),
+		[CC_QUOTE]     = DO(ACT_STRING),    [CC_EQ]        = ACCEPT(TOK_EQ),
+		[CC_GT]        = SHIFT(ST_GT),      [CC_LT]        = SHIFT(ST_LT),
+		[CC_HASH]      = ACCEPT(TOK_NE),    [CC_MINUS]     = SHIFT(ST_MINUS),
+		[CC_PLUS]      = ACCEPT(TOK_PLUS),  [CC_SLASH]     = ACCEPT(TOK_DIV),
+		[CC_STAR]      = ACCEPT(TOK_MUL),   [CC_PERCENT]   = ACCEPT(TOK_MOD),
+		[CC_AMPERSAND] = ACCEPT(TOK_AMPERSAND),
+		[CC_LBRACK]    = ACCEPT(TOK_LBRACK),
+		[CC_RBRACK]    = ACCEPT(TOK_RBRACK),
+		[CC_COMMA]     = ACCEPT(TOK_COMMA), [CC_LPAR]      = SHIFT(ST_LPAR),
+		[CC_RPAR]      = ACCEPT(TOK_RPAR),
+		[CC_SEMICOLON] = ACCEPT(TOK_SEMICOLON)
+	},
+	[ST_LT]    = { [CC_EQ] = ACCEPT(TOK_LE), [CC_MINUS] = ACCEPT(TOK_GETS) },
+	[ST_GT]    = { [CC_EQ] = ACCEPT(TOK_GE) },
+	[ST_MINUS] = { [CC_GT] = ACCEPT(TOK_TO) },
+	[ST_LPAR]  = { [CC_STAR] = DO(ACT_COMMENT) }
+};
 
 /* --- function prototypes -------------------------------------------------- */
 
+static void load_source(FILE *in_file);
+static void scan_token(Token *token);
+static void *scan_ahead(void *arg);
+static void *scan_slice(void *arg);
+static Boolean merge_slice(Slice *slice, size_t *next);
+static Boolean merge_slots(const TokenSlot *slots, size_t count);
+static Boolean rescan_slice(Slice *slice, size_t *next);
+static TokenSlot *add_slot(TokenSlot **slots, size_t *count, size_t *size);
+static size_t find_slot(const Slice *slice, size_t start);
+static void stop_scanning_ahead(void);
+static void seek(size_t offset);
+static Boolean refill(void);
+static void begin_lexeme(void);
+static void spill_lexeme(void);
+static void keep_char(int c);
+static void add_line(size_t start);
+static void index_lines(size_t offset);
+static SourcePos offset_position(size_t offset);
 static void next_char(void);
 static void process_number(Token *token);
 static void process_string(Token *token);
 static void process_word(Token *token);
 static void skip_comment(void);
-void append(char* s, char ch);
 
 /* --- scanner interface ---------------------------------------------------- */
 
 void init_scanner(FILE *in_file)
 {
 	src_file = in_file;
-	position.line = 1;
-	position.col = column_number = 0;
+	init_charscan();
+	load_source(in_file);
+	num_lines = 0;
+	add_line(src_base + src_pos);
+	lines_indexed = src_base + src_pos;
+	token_start = src_base + src_pos;
+	lex_open = lex_spilled = FALSE;
 	next_char();
 }
 
+void release_scanner(void)
+{
+	if (ahead) {
+		stop_scanning_ahead();
+	}
+	if (src_stream) {
+		free(chunk[0]);
+		free(chunk[1]);
+		chunk[0] = chunk[1] = NULL;
+	} else if (src_mapped) {
+		munmap(src_buf, src_size);
+	} else {
+		free(src_buf);
+	}
+	src_buf = NULL;
+	src_size = src_pos = src_base = 0;
+	src_mapped = src_stream = FALSE;
+
+	free(lexbuf);
+	lexbuf = NULL;
+	lexbuf_size = lexbuf_len = 0;
+
+	free(line_starts);
+	line_starts = NULL;
+	num_lines = max_lines = 0;
+}
+
+Boolean start_scanner_thread(void)
+{
+	if (src_stream) {
+		return FALSE;
+	}
+
+	if ((ring = aligned_alloc(_Alignof(TokenRing), sizeof(TokenRing))) == NULL) {
+		eprintf("allocation of token ring failed:");
+	}
+	init_token_ring(ring);
+	ahead_from = CH_OFFSET;
+	ahead = threaded = TRUE;
+	if (pthread_create(&scan_thread, NULL, scan_ahead, NULL) != 0) {
+		ahead = threaded = FALSE;
+		free(ring);
+		ring = NULL;
+	}
+
+	return threaded;
+}
+
+Boolean scan_in_parallel(int num_threads)
+{
+	Slice slices[MAX_SLICES];
+	size_t start, begin, next, size;
+	const char *nl;
+	int i, n;
+
+	if (src_stream) {
+		return FALSE;
+	}
+
+	/* cut the rest of the source into slices of about the same size, each of
+	 * which starts at the start of a line */
+	start = begin = CH_OFFSET;
+	size = src_size - start;
+	if (num_threads > MAX_SLICES) {
+		num_threads = MAX_SLICES;
+	}
+	if (num_threads > (int) (size / MIN_SLICE_SIZE)) {
+		num_threads = (int) (size / MIN_SLICE_SIZE);
+	}
+	if (num_threads < 1) {
+		num_threads = 1;
+	}
+	for (i = n = 0; i < num_threads; i++) {
+		slices[n].begin = begin;
+		if (i == num_threads - 1) {
+			/* the last slice takes the end of the source with it */
+			slices[n].end = src_size + 1;
+		} else {
+			next = start + size / num_threads * (i + 1);
+			nl = (next < src_size
+					? memchr(src_buf + next, '\n', src_size - next) : NULL);
+			slices[n].end = (nl != NULL ? (size_t) (nl - src_buf) + 1
+					: src_size + 1);
+		}
+		if (slices[n].end > begin) {
+			begin = slices[n].end;
+			n++;
+		}
+		if (begin > src_size) {
+			break;
+		}
+	}
+
+	/* scan the slices */
+	for (i = 0; i < n; i++) {
+		slices[i].slots = NULL;
+		slices[i].count = slices[i].size = 0;
+		slices[i].exit = src_size;
+		if (pthread_create(&slices[i].thread, NULL, scan_slice, &slices[i])
+				!= 0) {
+			eprintf("could not start scanner thread:");
+		}
+	}
+	for (i = 0; i < n; i++) {
+		pthread_join(slices[i].thread, NULL);
+	}
+
+	/* keep the trusted slots of each slice, up to the end or the first error */
+	scanned = NULL;
+	num_scanned = max_scanned = next_scanned = 0;
+	next = slices[0].begin;
+	for (i = 0; i < n && merge_slice(&slices[i], &next); i++)
+		;
+	for (i = 0; i < n; i++) {
+		free(slices[i].slots);
+	}
+
+	ahead = TRUE;
+
+	return TRUE;
+}
+
+SourcePos get_position(void)
+{
+	SourcePos pos;
+
+	if (ahead) {
+		pos.line = offset_position(slot_end).line;
+		pos.col = offset_position(slot_start).col;
+	} else {
+		pos.line = offset_position(CH_OFFSET).line;
+		pos.col = offset_position(token_start).col;
+	}
+
+	return pos;
+}
+
+const char *get_lexeme(const Token *token)
+{
+	if (!src_stream) {
+		return src_buf + token->offset;
+	} else if (lex_spilled && token->offset == lex_offset) {
+		return lexbuf;
+	} else if (token->offset >= src_base) {
+		return src_buf + (token->offset - src_base);
+	} else {
+		return chunk[!curr_chunk] + (token->offset - chunk_base[!curr_chunk]);
+	}
+}
+
+char *get_string(const Token *token)
+{
+	char *s;
+
+	s = emalloc(token->length + 1);
+	memcpy(s, get_lexeme(token), token->length);
+	s[token->length] = '\0';
+
+	return s;
+}
+
 void get_token(Token *token)
 {
-	/* remove whitespace */
-	/* TODO: Skip all whitespace characters before the start of the token. */
-	if (isspace(ch)) {
-		while (isspace(ch)) {
+	TokenSlot slot;
+
+	if (threaded) {
+		ring_pop(ring, &slot);
+	} else if (ahead) {
+		slot = scanned[next_scanned++];
+	} else {
+		scan_token(token);
+		return;
+	}
+
+	if (slot.failed || slot.token.type == TOK_EOF) {
+		/* the tokens scanned ahead have run out; scan the last one again, on
+		 * this thread, which also reports the error, if there is one */
+		stop_scanning_ahead();
+		seek(slot.start);
+		scan_token(token);
+		return;
+	}
+
+	*token = slot.token;
+	slot_start = slot.start;
+	slot_end = slot.end;
+	if (token->type == TOK_ID) {
+		token->symbol = intern(src_buf + token->offset, token->length);
+	}
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+static void scan_token(Token *token)
+{
+	int state;
+	size_t skip;
+	const Move *move;
+
+	for (;;) {
+		/* remove whitespace, taking runs of blanks in one stride */
+		while (CHAR_CLASS(ch) == CC_SPACE) {
+			if (ch == '\n') {
+				PASS_NEWLINE();
+			}
 			next_char();
+			if (ch == ' ' || ch == '\t') {
+				skip = scan_blanks(src_buf, src_pos, src_size) - src_pos;
+				if (skip > 0) {
+					ADVANCE(skip);
+				}
+			}
 		}
-	}
-	/* remember token start */
-	position.col = column_number;
-	/* get next token*/
-	if (ch != EOF) {
-		if (isalpha(ch) || ch == '_') {
-			/* process a word */
-			process_word(token);
-
-		} else if (isdigit(ch)) {
-			/* process a number */
-			process_number(token);
-
-		} else
-			switch (ch) {
-				/* process a string */
-				case '"':
-					position.col = column_number;
-					next_char();
-					process_string(token);
-					break;
 
-				/* TODO: Process the other tokens, and trigger comment skipping.
-				 */
-				case '=':
-					next_char();
-					token->type = TOK_EQ;
-					break;
-				case '>':
-					next_char();
-					if (ch == '=') {
-						next_char();
-						token->type = TOK_GE;
-						break;
-					} else {
-						token->type = TOK_GT;
-						break;
-					}
-				case '<':
-					next_char();
-					if (ch == '=') {
-						next_char();
-						token->type = TOK_LE;
-						break;
-					} else if (ch == '-') {
-						next_char();
-						token->type = TOK_GETS;
-						break;
-					} else {
-						token->type = TOK_LT;
-						break;
-					}
-				case '#':
-					next_char();
-					token->type = TOK_NE;
-					break;
-				case '-':
-					next_char();
-					if (ch == '>') {
-						next_char();
-						token->type = TOK_TO;
-						break;
-					} else {
-						token->type = TOK_MINUS;
-						break;
-					}
-				case '+':
-					next_char();
-					token->type = TOK_PLUS;
-					break;
-				case '/':
-					next_char();
-					token->type = TOK_DIV;
-					break;
-				case '*':
-					next_char();
-					token->type = TOK_MUL;
-					break;
-				case '%':
-					next_char();
-					token->type = TOK_MOD;
-					break;
-				case '&':
-					next_char();
-					token->type = TOK_AMPERSAND;
-					break;
-				case '[':
-					next_char();
-					token->type = TOK_LBRACK;
-					break;
-				case ']':
-					next_char();
-					token->type = TOK_RBRACK;
-					break;
-				case ',':
-					next_char();
-					token->type = TOK_COMMA;
-					break;
-				case '(':
-					position.col = column_number;
+		/* remember token start */
+		token_start = token->offset = CH_OFFSET;
+		token->length = 0;
+		if (ch == EOF) {
+			token->type = TOK_EOF;
+			return;
+		}
+
+		/* run the DFA from the start state until it accepts a token */
+		state = ST_START;
+		for (;;) {
+			move = &dfa[state][CHAR_CLASS(ch)];
+			switch (move->action) {
+				case ACT_SHIFT:
 					next_char();
-					if (ch == '*') {
-						skip_comment();
-						get_token(token);
-					} else {
-						token->type = TOK_LPAR;
-					}
-					break;
-				case ')':
+					state = move->arg;
+					continue;
+				case ACT_ACCEPT:
 					next_char();
-					token->type = TOK_RPAR;
-					break;
-				case ';':
+					token->type = (TokenType) move->arg;
+					token->length = CH_OFFSET - token->offset;
+					return;
+				case ACT_PENDING:
+					token->type = pending[state];
+					token->length = CH_OFFSET - token->offset;
+					return;
+				case ACT_WORD:
+					process_word(token);
+					return;
+				case ACT_NUMBER:
+					process_number(token);
+					return;
+				case ACT_STRING:
 					next_char();
-					token->type = TOK_SEMICOLON;
+					process_string(token);
+					return;
+				case ACT_COMMENT:
+					skip_comment();
 					break;
 				default:
+					DEFER_ERROR();
+					position = get_position();
 					leprintf("illegal character '%c' (ASCII #%d)", ch, ch);
 			}
+			/* a comment was skipped; start over with the next token */
+			break;
+		}
+	}
+}
 
-	} else {
-		token->type = TOK_EOF;
+static void *scan_ahead(void *arg)
+{
+	TokenSlot *slot;
+
+	(void) arg;
+
+	deferring = TRUE;
+	seek(ahead_from);
+	if (setjmp(scan_abort) != 0) {
+		if ((slot = ring_reserve(ring)) != NULL) {
+			slot->failed = TRUE;
+			slot->start = resume_offset;
+			ring_push(ring);
+			ring_flush(ring);
+		}
+		return NULL;
 	}
+
+	do {
+		if ((slot = ring_reserve(ring)) == NULL) {
+			/* the parser has quit */
+			return NULL;
+		}
+		resume_offset = CH_OFFSET;
+		scan_token(&slot->token);
+		slot->start = token_start;
+		slot->end = CH_OFFSET;
+		slot->failed = FALSE;
+		ring_push(ring);
+	} while (slot->token.type != TOK_EOF);
+	ring_flush(ring);
+
+	return NULL;
 }
 
-/* --- utility functions ---------------------------------------------------- */
+static void *scan_slice(void *arg)
+{
+	Slice *slice = arg;
+	TokenSlot *slot;
+	Token token;
 
-void next_char(void)
+	deferring = TRUE;
+	seek(slice->begin);
+	if (setjmp(scan_abort) != 0) {
+		slot = add_slot(&slice->slots, &slice->count, &slice->size);
+		slot->failed = TRUE;
+		slot->start = resume_offset;
+		return NULL;
+	}
+
+	do {
+		resume_offset = CH_OFFSET;
+		scan_token(&token);
+		if (token_start >= slice->end) {
+			slice->exit = token_start;
+			break;
+		}
+		slot = add_slot(&slice->slots, &slice->count, &slice->size);
+		slot->token = token;
+		slot->start = token_start;
+		slot->end = CH_OFFSET;
+		slot->failed = FALSE;
+	} while (token.type != TOK_EOF);
+
+	return NULL;
+}
+
+/* Adds the trusted slots of the specified slice to scanned, given the start of
+ * the next token of the sequential scan.  Returns whether the scan goes on past
+ * the slice, that is, whether it neither ends nor fails in it. */
+static Boolean merge_slice(Slice *slice, size_t *next)
 {
-	/*static char last_read = '\0';*/
-	static char new_line;
-	ch = getc(src_file);
+	size_t k;
 
-	if (new_line == '\n') {
-		position.line++;
-		column_number = 1;
-		new_line = 'a';
+	if (*next >= slice->end) {
+		/* a comment ran over the whole slice */
+		return TRUE;
 	}
-	column_number++;
-	if (ch == '\n') {
-		new_line = ch;
+	if (*next == slice->begin) {
+		/* the slice was scanned from where the sequential scan stands */
+		k = 0;
+	} else if ((k = find_slot(slice, *next)) == slice->count) {
+		return rescan_slice(slice, next);
 	}
+	*next = slice->exit;
 
-	/* TODO:
-	 *	Get the next character from the source file.
-	 * - Increment the line number if the previous character is EOL.
-	 * - Reset the global column number when necessary.
-	 * - DO NOT USE feof!!!
-	 */
+	if (scanned == NULL && k == 0) {
+		/* the slots of the first slice are all trusted, so take them over */
+		scanned = slice->slots;
+		num_scanned = slice->count;
+		max_scanned = slice->size;
+		slice->slots = NULL;
+		return (num_scanned == 0 || (!scanned[num_scanned - 1].failed
+					&& scanned[num_scanned - 1].token.type != TOK_EOF));
+	}
+
+	return merge_slots(slice->slots + k, slice->count - k);
 }
 
-void process_number(Token *token)
+static Boolean merge_slots(const TokenSlot *slots, size_t count)
 {
-	int i, v, x;
-	char d1[12];
-	char d2[2];
-	int *sum = (int *)malloc(sizeof(int));
-	/*if (ch == '-') {
-		append(d1, ch);
-		next_char();
-	}*/
-	i = ch - '0';
-	sprintf(d1, "%i", i);	
-	while (isdigit(ch)) {
-		v = atoi(d1);
-		next_char();
-		/*if (!isdigit(ch)) {
-			break;
-		}*/
-		i = ch - '0';
-		*sum = v + i;
-		if (v > 0 && i > 0 && *sum < 0){
-			x = -1;
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		*add_slot(&scanned, &num_scanned, &max_scanned) = slots[i];
+		if (slots[i].failed || slots[i].token.type == TOK_EOF) {
+			return FALSE;
 		}
-		if (v < 0 && i < 0 && *sum > 0) {
-			x = -1;
+	}
+
+	return TRUE;
+}
+
+/* Scans the specified slice again from the start of the next token of the
+ * sequential scan, until the scan leaves the slice, or meets the slots of the
+ * slice, which are then trusted. */
+static Boolean rescan_slice(Slice *slice, size_t *next)
+{
+	TokenSlot *slot;
+	Token token;
+	size_t k;
+
+	deferring = TRUE;
+	seek(*next);
+	if (setjmp(scan_abort) != 0) {
+		deferring = FALSE;
+		slot = add_slot(&scanned, &num_scanned, &max_scanned);
+		slot->failed = TRUE;
+		slot->start = resume_offset;
+		return FALSE;
+	}
+
+	for (;;) {
+		resume_offset = CH_OFFSET;
+		scan_token(&token);
+		if (token_start >= slice->end) {
+			deferring = FALSE;
+			*next = token_start;
+			return TRUE;
+		}
+		if ((k = find_slot(slice, token_start)) < slice->count) {
+			deferring = FALSE;
+			*next = slice->exit;
+			return merge_slots(slice->slots + k, slice->count - k);
+		}
+		slot = add_slot(&scanned, &num_scanned, &max_scanned);
+		slot->token = token;
+		slot->start = token_start;
+		slot->end = CH_OFFSET;
+		slot->failed = FALSE;
+		if (token.type == TOK_EOF) {
+			deferring = FALSE;
+			return FALSE;
+		}
+	}
+}
+
+static TokenSlot *add_slot(TokenSlot **slots, size_t *count, size_t *size)
+{
+	if (*count == *size) {
+		*size = (*size ? 2 * *size : 1024);
+		*slots = erealloc(*slots, *size * sizeof(TokenSlot));
+	}
+
+	return &(*slots)[(*count)++];
+}
+
+/* the index of the (unfailed) slot of the slice of the token that starts at the
+ * specified offset, or the number of slots if there is none */
+static size_t find_slot(const Slice *slice, size_t start)
+{
+	size_t lo, hi, mid;
+
+	lo = 0;
+	hi = slice->count;
+	if (hi > 0 && slice->slots[hi - 1].failed) {
+		hi--;
+	}
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (slice->slots[mid].start < start) {
+			lo = mid + 1;
 		} else {
-			x = 0;
+			hi = mid;
 		}
-		if (x == -1){
-			if (position.line > 2) {
-				SourcePos start_pos = {position.line - 1, position.col - 1};
-				position = start_pos;
-			} else {
-				if (position.col > 1) {
-					SourcePos start_pos = {position.line, position.col - 1};
-					position = start_pos;
-				} else {
-					SourcePos start_pos = {position.line, position.col};
-                                        position = start_pos;
-				}
+	}
+
+	return (lo < slice->count && !slice->slots[lo].failed
+			&& slice->slots[lo].start == start ? lo : slice->count);
+}
+
+static void stop_scanning_ahead(void)
+{
+	if (threaded) {
+		ring_close(ring);
+		pthread_join(scan_thread, NULL);
+		free(ring);
+		ring = NULL;
+	}
+	free(scanned);
+	scanned = NULL;
+	ahead = threaded = FALSE;
+}
+
+/* moves ch to the character at the specified offset of the buffer */
+static void seek(size_t offset)
+{
+	src_pos = offset - src_base;
+	next_char();
+}
+
+static void load_source(FILE *in_file)
+{
+	int fd;
+	off_t start;
+	size_t nread;
+	struct stat st;
+
+	src_buf = NULL;
+	src_size = src_pos = src_base = 0;
+	src_mapped = src_stream = FALSE;
+
+	/* anything that is not a regular file is streamed */
+	fd = fileno(in_file);
+	if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)
+			|| (start = ftello(in_file)) < 0 || start > st.st_size) {
+		chunk[0] = emalloc(CHUNK_SIZE);
+		chunk[1] = emalloc(CHUNK_SIZE);
+		chunk_base[0] = chunk_base[1] = 0;
+		curr_chunk = 0;
+		src_buf = chunk[0];
+		src_stream = TRUE;
+		src_eof = FALSE;
+		return;
+	}
+
+	src_size = (size_t) st.st_size;
+	if (src_size == 0) {
+		/* mmap refuses empty mappings, so use a (non-NULL) empty buffer */
+		src_buf = emalloc(1);
+	} else {
+		src_buf = mmap(NULL, src_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (src_buf != MAP_FAILED) {
+			src_mapped = TRUE;
+		} else {
+			src_buf = emalloc(src_size);
+			if (fseeko(in_file, 0, SEEK_SET) < 0) {
+				eprintf("could not read source file:");
 			}
-			leprintf("number too large");
+			nread = fread(src_buf, 1, src_size, in_file);
+			if (nread < src_size && ferror(in_file)) {
+				eprintf("could not read source file:");
+			}
+			src_size = nread;
 		}
-		if (!isdigit(ch)) {
-			break;
+	}
+
+	src_pos = (size_t) start;
+}
+
+static void add_line(size_t start)
+{
+	if (num_lines == max_lines) {
+		max_lines = (max_lines ? 2 * max_lines : INITIAL_LINES);
+		line_starts = erealloc(line_starts, max_lines * sizeof(size_t));
+	}
+	line_starts[num_lines++] = start;
+}
+
+static void index_lines(size_t offset)
+{
+	const char *p, *end;
+
+	/* the lines of a stream are counted as they are passed */
+	if (src_stream || offset <= lines_indexed) {
+		return;
+	}
+
+	end = src_buf + (offset < src_size ? offset : src_size);
+	for (p = src_buf + lines_indexed;
+			(p = memchr(p, '\n', end - p)) != NULL; p++) {
+		add_line(p - src_buf + 1);
+	}
+	lines_indexed = offset;
+}
+
+/* The position of the character at the specified offset.  The columns follow
+ * the numbering that the error messages have always used: the first character
+ * is in column 1 on the first line, but in column 2 on the others.  For a
+ * stream, the offset must lie on the current line. */
+static SourcePos offset_position(size_t offset)
+{
+	size_t lo, hi, mid;
+	SourcePos pos;
+
+	if (src_stream) {
+		pos.line = (int) num_lines;
+		pos.col = (int) (offset - line_starts[0]) + (num_lines == 1 ? 1 : 2);
+		return pos;
+	}
+
+	/* find the last line that starts at or before the offset */
+	index_lines(offset);
+	lo = 0;
+	hi = num_lines;
+	while (hi - lo > 1) {
+		mid = lo + (hi - lo) / 2;
+		if (line_starts[mid] <= offset) {
+			lo = mid;
+		} else {
+			hi = mid;
+		}
+	}
+
+	pos.line = (int) lo + 1;
+	pos.col = (int) (offset - line_starts[lo]) + (lo == 0 ? 1 : 2);
+
+	return pos;
+}
+
+/* Fills the other chunk from the stream, and makes it the buffer.  A lexeme
+ * that is still being collected is spilled first, since the chunk it lies in
+ * is overwritten at the next refill. */
+static Boolean refill(void)
+{
+	int next;
+	size_t nread;
+
+	if (src_eof) {
+		return FALSE;
+	}
+	next = !curr_chunk;
+	nread = fread(chunk[next], 1, CHUNK_SIZE, src_file);
+	if (nread == 0) {
+		if (ferror(src_file)) {
+			eprintf("could not read source file:");
 		}
-		sprintf(d2, "%i", i);
-		strcat(d1, d2);
+		src_eof = TRUE;
+		return FALSE;
+	}
+
+	if (lex_open && !lex_spilled) {
+		spill_lexeme();
 	}
+	chunk_base[next] = src_base + src_size;
+	curr_chunk = next;
+	src_buf = chunk[next];
+	src_base = chunk_base[next];
+	src_size = nread;
+	src_pos = 0;
 
-	i = atoi(d1);
-	token->value = i;
+	return TRUE;
+}
+
+static void begin_lexeme(void)
+{
+	lex_offset = CH_OFFSET;
+	lex_open = TRUE;
+	lex_spilled = FALSE;
+	lexbuf_len = 0;
+}
+
+/* copies the part of the open lexeme that lies in the current chunk to lexbuf;
+ * the characters that follow are added by KEEP_CHAR */
+static void spill_lexeme(void)
+{
+	size_t i;
+
+	for (i = lex_offset - src_base; i < src_size; i++) {
+		keep_char(src_buf[i]);
+	}
+	lex_spilled = TRUE;
+}
+
+static void keep_char(int c)
+{
+	if (lexbuf_len == lexbuf_size) {
+		lexbuf_size = (lexbuf_size ? 2 * lexbuf_size : MAX_INITIAL_STRLEN);
+		lexbuf = erealloc(lexbuf, lexbuf_size);
+	}
+	lexbuf[lexbuf_len++] = (char) c;
+}
+
+void next_char(void)
+{
+	if (src_pos < src_size || (src_stream && refill())) {
+		ch = (unsigned char) src_buf[src_pos++];
+	} else {
+		ch = EOF;
+	}
+}
+
+void process_number(Token *token)
+{
+	int value, digit;
+
+	/* accumulate the value, checking before each step that it cannot exceed
+	 * INT_MAX */
+	value = 0;
+	while (CHAR_CLASS(ch) == CC_DIGIT) {
+		digit = ch - '0';
+		if (value > (INT_MAX - digit) / 10) {
+			/* reported at the first digit */
+			DEFER_ERROR();
+			position = offset_position(token->offset);
+			if (position.line > 1) {
+				position.col--;
+			}
+			leprintf("number too large");
+		}
+		value = value * 10 + digit;
+		next_char();
+	}
+
+	token->value = value;
 	token->type = TOK_NUM;
-	/* TODO:
-	 * - Build number up to the specified maximum magnitude.
-	 * - Store the value in the appropriatetoken field.
-	 * - Set the appropriate token type.
-	 * - "Remember" the correct column number globally.
-	 */
+	token->length = CH_OFFSET - token->offset;
 }
 
 void process_string(Token *token)
 {
-	size_t j, nstring = MAX_INITIAL_STRLEN;
-	token->string = (char *)malloc(nstring);
-	j = 0;
-	int line = position.line;
+	char ec[3];
+
+	/* the lexeme is the text between the quotes, escape codes included */
+	token->offset = CH_OFFSET;
+	BEGIN_LEXEME();
 
 	while (ch != '"') {
-		if (ch == '"') {
-			break;
-		}
-		if (ch < 32 && ch != -1 && ch != '\\') {
+		if (ch < 32 && ch != EOF) {
+			DEFER_ERROR();
+			position = offset_position(CH_OFFSET);
 			if (position.line > 1) {
-                        	SourcePos start_pos = {line, column_number - 1};
-                        	position = start_pos;
-			} else {
-				SourcePos start_pos = {line, column_number};
-                                position = start_pos;
+				position.col--;
 			}
-                        leprintf("non-printable character (ASCII #%d) in string", ch);
-                }
+			leprintf("non-printable character (ASCII #%d) in string", ch);
+		}
 		if (ch == EOF) {
-			int pos;
-			if (position.col == 1) {
-				pos = 1;
-			} else {
-				pos = position.col - 1;
+			/* reported at the opening quote */
+			DEFER_ERROR();
+			position = offset_position(token_start);
+			if (position.col > 1) {
+				position.col--;
 			}
-			SourcePos start = {line, pos};
-			position = start;
 			leprintf("string not closed");
 		}
-		j++;
-		if (j > nstring) {
-			token->string = (char *)realloc(token->string, 2 * nstring);
-		}
 		if (ch == '\\') {
-			append(token->string, ch);
-			char ec[3];
-			append(ec, ch);
+			KEEP_CHAR();
 			next_char();
-			j++;
 			if (ch != 'n' && ch != 't' && ch != '"' && ch != '\\') {
-				append(ec, ch);
-				SourcePos start = {line, column_number - 1};
-				position = start;
+				ec[0] = '\\';
+				ec[1] = (char) ch;
+				ec[2] = '\0';
+				DEFER_ERROR();
+				position = offset_position(CH_OFFSET);
+				position.col--;
 				leprintf("illegal escape code '%s' in string", ec);
 			}
 		}
-		append(token->string, ch);
+		KEEP_CHAR();
 		next_char();
 	}
 
+	token->length = CH_OFFSET - token->offset;
+	END_LEXEME();
 	next_char();
 	token->type = TOK_STR;
-	/* TODO:
-	 * - Allocate heap space of the size of the maximum initial string length.
-	 * - If a string is *about* to overflow while scanning it, double the amount
-	 *	 of space available.
-	 * - *Only* printable ASCII characters are allowed; see man 3 isalpha.
-	 * - Check the legality of escape codes.
-	 * - Set the appropriate token type.
-	 */
 }
 
 void process_word(Token *token)
 {
-	char lexeme[MAX_ID_LENGTH + 1] = "";
-	int cmp, low, mid, high;
-	cmp = -1;
-	low = 0;
-	high = NUM_RESERVED_WORDS;
-
-	int length = 0;
-	while (isalpha(ch) || ch == '_' || isdigit(ch)) {
-		length++;
+	unsigned int h, length;
+	const char *lexeme;
+	const ReservedWord *rw;
+
+	/* hash the word on the way, counting its length as we go */
+	h = 0;
+	length = 0;
+	BEGIN_LEXEME();
+	while (IS_WORD_CHAR(ch)) {
 		/* check that the id length is less than the maximum */
-		/* TODO */
-		if (length > MAX_ID_LENGTH) {
+		if (length == MAX_ID_LENGTH) {
+			DEFER_ERROR();
+			position = offset_position(token->offset);
 			if (position.line > 1) {
-				SourcePos start_pos = {position.line, position.col - 1};
-				position = start_pos;
-			} else {
-				SourcePos start_pos = {position.line, position.col};
-				position = start_pos;
+				position.col--;
 			}
 			leprintf("identifier too long");
 		}
-		if (!isalpha(ch) && ch != '_' && !isdigit(ch)) {
-			break;
-		}
-		append(lexeme, ch);
+		KEEP_CHAR();
+		length++;
+		h = h * RESERVED_HASH_MULT + (unsigned int) ch;
 		next_char();
 	}
+	token->length = length;
+	END_LEXEME();
+	lexeme = get_lexeme(token);
 
-	/* do a binary search through the array of reserved words */
-	/* TODO */
-	while (low <= high) {
-		mid = (low + high) / 2;
-		if (strcmp(lexeme, reserved[mid].word) == 0) {
-			cmp = 0;
-			break;
-		} else if (strcmp(lexeme, reserved[mid].word) > 0) {
-			low = mid + 1;
-		} else {
-			high = mid - 1;
+	/* look the word up in the perfect hash table of reserved words */
+	token->type = TOK_ID;
+	if (length >= RESERVED_MIN_LENGTH && length <= RESERVED_MAX_LENGTH
+			&& RESERVED_FIRST(lexeme[0])) {
+		rw = &reserved[(h >> RESERVED_HASH_SHIFT) & RESERVED_HASH_MASK];
+		if (rw->length == length && memcmp(lexeme, rw->word, length) == 0) {
+			token->type = rw->type;
 		}
 	}
-
-	/* if id was not recognised as a reserved word, it is an identifier */
-	if (cmp == 0) {
-		token->type = reserved[mid].type;
-	} else {
-		token->type = TOK_ID;
+	if (token->type == TOK_ID) {
+		token->symbol = (deferring ? NO_SYMBOL : intern(lexeme, length));
 	}
-	
-	strcpy(token->lexeme, lexeme);
 }
 
 void skip_comment(void)
 {
-	SourcePos start_pos = {position.line, column_number - 2};
+	size_t start, skip;
+	SourcePos start_pos;
+
+	/* ch is the '*' of the opening "(*"; a stream cannot be looked back on, so
+	 * its position is taken now */
+	start = CH_OFFSET;
+	start_pos.line = start_pos.col = 0;
+	if (src_stream) {
+		start_pos = offset_position(start);
+	}
+
 	while (ch != EOF) {
         	if (ch == '(') {
         		next_char();
@@ -423,10 +1138,23 @@ void skip_comment(void)
 				return;
 			}
 		} else {
+			if (ch == '\n') {
+				PASS_NEWLINE();
+			}
 			next_char();
+			/* only '(', '*', and newlines matter; pass over the rest in one
+			 * stride */
+			if (ch != EOF && ch != '(' && ch != '*' && ch != '\n') {
+				skip = scan_comment_text(src_buf, src_pos, src_size) - src_pos;
+				if (skip > 0) {
+					ADVANCE(skip);
+				}
+			}
         	}
 	}
-	position = start_pos;
+	DEFER_ERROR();
+	position = (src_stream ? start_pos : offset_position(start));
+	position.col -= 2;
 	leprintf("comment not closed");
 	/* TODO:
 	 * - Skip nested comments *recursively*, which is to say, counting
@@ -436,10 +1164,3 @@ void skip_comment(void)
 
 	/* force the line number of error reporting */
 }
-
-void append(char* s, char ch)
-{
-        int len = strlen(s);
-        s[len] = ch;
-        s[len+1] = '\0';
-}
@@ -10,16 +10,61 @@
 #define SCANNER_H
 
 #include <stdio.h>
+#include "boolean.h"
+#include "error.h"
 #include "token.h"
 
 /**
- * Initialises the scanner.
+ * Initialises the scanner.  If the source is a regular file, it is mapped into
+ * memory (or read in one go) and scanned from the buffer; otherwise, for
+ * example, for pipes, it is read in fixed-size chunks, so that the scanner
+ * needs the same amount of memory however long the source is.
+ * Identifiers are interned as they are scanned, so the interning pool must be
+ * initialised first.
  *
  * @param[in]   in_file
  *     the (already open) source file
  */
 void init_scanner(FILE *in_file);
 
+/**
+ * Releases the source buffer held by the scanner, if any, and stops the
+ * scanner thread, if it is still running.  The source file itself is left
+ * open.
+ */
+void release_scanner(void);
+
+/**
+ * Moves scanning to a thread of its own, which scans ahead of the parser and
+ * hands the tokens to <code>get_token</code> through a ring buffer, so that
+ * scanning and parsing overlap.  A scanner error is still only reported when
+ * <code>get_token</code> reaches the token at which it occurs.  This must be
+ * called after <code>init_scanner</code>, before the first token is read.  A
+ * source read from a stream is always scanned on the calling thread.
+ *
+ * @return      <code>TRUE</code> if the scanner thread was started, or
+ *              <code>FALSE</code> if scanning stays on the calling thread
+ */
+Boolean start_scanner_thread(void);
+
+/**
+ * Scans the whole source up front, on the specified number of threads, each of
+ * which scans a slice of the source; <code>get_token</code> then hands out the
+ * tokens in order.  The tokens, and any scanner error, are exactly those of a
+ * sequential scan, and the error is still only reported when
+ * <code>get_token</code> reaches it.  Small sources are cut into fewer slices
+ * than there are threads.  This must be called after <code>init_scanner</code>,
+ * before the first token is read, and instead of
+ * <code>start_scanner_thread</code>.  A source read from a stream is always
+ * scanned on the calling thread, token by token.
+ *
+ * @param[in]   num_threads
+ *     the number of threads on which to scan
+ * @return      <code>TRUE</code> if the source was scanned up front, or
+ *              <code>FALSE</code> if it is scanned as the tokens are read
+ */
+Boolean scan_in_parallel(int num_threads);
+
 /**
  * Gets the next token from the input (source) file.
  *
@@ -28,4 +73,38 @@ void init_scanner(FILE *in_file);
  */
 void get_token(Token *token);
 
+/**
+ * Returns the position at which errors about the current token are reported:
+ * the line of the character after the token, and the column of the start of
+ * the token.  Positions are not tracked while scanning; they are worked out
+ * from the byte offsets only when this function is called, which is intended
+ * to be when an error is about to be reported.
+ *
+ * @return      the position of the current token
+ */
+SourcePos get_position(void);
+
+/**
+ * Returns the characters of the lexeme of the specified token, which is
+ * <code>token->length</code> characters long, and not NUL-terminated.  When
+ * the source is read from a stream, the lexeme is only available until the
+ * next call to <code>get_token</code>.
+ *
+ * @param[in]   token
+ *     the token of which to return the lexeme
+ * @return      a pointer to the first character of the lexeme
+ */
+const char *get_lexeme(const Token *token);
+
+/**
+ * Returns a newly allocated, NUL-terminated copy of the contents of the
+ * specified string token.  Escape codes are left as they appear in the source,
+ * since the Jasmin assembler interprets them itself.
+ *
+ * @param[in]   token
+ *     the string token
+ * @return      a copy of the string, which the caller must free
+ */
+char *get_string(const Token *token);
+
 #endif /* SCANNER_H */
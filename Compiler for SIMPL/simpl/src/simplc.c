@@ -15,6 +15,8 @@
  */
 
 /* TODO: Include the appropriate system and project header file. */
+#include <stdarg.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -23,6 +25,7 @@
 #include "errmsg.h"
 #include "error.h"
 #include "hashtable.h"
+#include "intern.h"
 #include "jvm.h"
 #include "scanner.h"
 #include "symboltable.h"
@@ -59,9 +62,9 @@ void debug_info(const char *fmt, ...);
 #if 1
 typedef struct variable_s Variable;
 struct variable_s {
-	char *id;		/**< variable identifier                       */
+	Symbol id;		/**< variable identifier                       */
 	ValType type;	/**< variable type                             */
-	SourcePos pos;	/**< variable position in the source           */
+	size_t offset;	/**< variable offset in the source             */
 	Variable *next; /**< pointer to the next variable in the list  */
 };
 #endif
@@ -131,11 +134,11 @@ void parse_name(void);
 void parse_read(void);
 void parse_while(void);
 void parse_write(void);
-void parse_index(char *id);
+void parse_index(Symbol id);
 void parse_simple(ValType *type);
 void parse_term(ValType *type);
 void parse_factor(ValType *type);
-void parse_arglist(char *id, IDprop *prop);
+void parse_arglist(Symbol id, IDprop *prop);
 void parse_expr(ValType *type);
 /* TODO: Add the prototypes for the rest of the parse function. */
 
@@ -149,11 +152,11 @@ void parse_expr(ValType *type);
 void check_types(ValType found, ValType expected, SourcePos *pos, ...);
 #endif
 void expect(TokenType type);
-void expect_id(char **id);
+void expect_id(Symbol *id);
 #if 1
 IDprop *make_idprop(ValType type, unsigned int offset, unsigned int nparams,
 					ValType *params);
-Variable *make_var(char *id, ValType type, SourcePos pos);
+Variable *make_var(Symbol id, ValType type, size_t offset);
 #endif
 
 /* --- function prototypes: error reporting --------------------------------- */
@@ -168,6 +171,9 @@ int main(int argc, char *argv[])
 #if 1
 	char *jasmin_path;
 #endif
+	char *src_name;
+	Boolean pipelined, stats;
+	int i, jobs;
 
 	/* TODO: Uncomment the previous definition for code generation. */
 
@@ -175,9 +181,26 @@ int main(int argc, char *argv[])
 	setprogname(argv[0]);
 
 	/* check command-line arguments and environment */
-	if (argc != 2) {
-		eprintf("usage: %s <filename>", getprogname());
+	pipelined = FALSE;
+	stats = FALSE;
+	jobs = 0;
+	for (i = 1; i < argc && strncmp(argv[i], "--", 2) == 0; i++) {
+		if (strcmp(argv[i], "--pipeline") == 0) {
+			pipelined = TRUE;
+		} else if (strcmp(argv[i], "--stats") == 0) {
+			stats = TRUE;
+		} else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc
+				&& (jobs = atoi(argv[i + 1])) > 0) {
+			i++;
+		} else {
+			break;
+		}
+	}
+	if (argc - i != 1) {
+		eprintf("usage: %s [--pipeline | --jobs <n>] [--stats] <filename | ->",
+				getprogname());
 	}
+	src_name = argv[i];
 
 	/* TODO: Uncomment the following for code generation. */
 #if 1
@@ -186,20 +209,35 @@ int main(int argc, char *argv[])
 	}
 #endif
 
-	/* open the source file, and report an error if it could not be opened. */
-	if ((src_file = fopen(argv[1], "r")) == NULL) {
-		eprintf("file '%s' could not be opened:", argv[1]);
+	/* open the source file, and report an error if it could not be opened;
+	 * "-" stands for the standard input stream */
+	if (strcmp(src_name, "-") == 0) {
+		src_file = stdin;
+		setsrcname("<stdin>");
+	} else {
+		if ((src_file = fopen(src_name, "r")) == NULL) {
+			eprintf("file '%s' could not be opened:", src_name);
+		}
+		setsrcname(src_name);
 	}
-	setsrcname(argv[1]);
 
 	/* initialise all compiler units */
+	init_intern();
 	init_scanner(src_file);
+	if (jobs > 0) {
+		scan_in_parallel(jobs);
+	} else if (pipelined) {
+		start_scanner_thread();
+	}
 	init_symbol_table();
 	init_code_generation();
 
 	/* compile */
 	get_token(&token);
 	parse_program();
+	if (stats) {
+		print_symbol_table_stats();
+	}
 
 	/* produce the object code, and assemble */
 	/* TODO: For code generation. */
@@ -211,7 +249,11 @@ int main(int argc, char *argv[])
 	 */
 	/*for some peculiar reason, it gets a seg fault when I free the symbol table*/
 	/*release_symbol_table();*/
-	fclose(src_file);
+	release_scanner();
+	release_intern();
+	if (src_file != stdin) {
+		fclose(src_file);
+	}
 	freeprogname();
 	freesrcname();
 
@@ -228,14 +270,14 @@ int main(int argc, char *argv[])
  */
 void parse_program(void)
 {
-	char *class_name;
+	Symbol class_name;
 	DBG_start("<program>");
 
 	/* TODO: For code generation, set the class name inside this function, and
 	 * also handle initialising and closing the "main" function.  But from the
 	 * perspective of simple parsing, this function is complete.
 	 */
-	init_subroutine_codegen("main", NULL);
+	init_subroutine_codegen(intern("main", sizeof("main") - 1), NULL);
 	
 	expect(TOK_PROGRAM);
 	expect_id(&class_name);
@@ -250,14 +292,12 @@ void parse_program(void)
 	gen_1(JVM_RETURN);
 	close_subroutine_codegen(get_variables_width());
 	
-	free(class_name);
-	
 	DBG_end("</program>");
 }
 
 void parse_funcdef(void)
 {
-	char *func_name;
+	Symbol func_name;
 	DBG_start("<funcdef>");
 	ValType type;
 	Variable *v;
@@ -265,14 +305,16 @@ void parse_funcdef(void)
 	IDprop *prop;
 	int nparams = 0;
 	ValType *params;
+	size_t id_offset;
 	expect(TOK_DEFINE);
 	expect_id(&func_name);
-	char *function_name = func_name;
+	Symbol function_name = func_name;
 	expect(TOK_LPAR);
 	if (IS_TYPE_TOKEN(token.type)) {
 		parse_type(&type);
+		id_offset = token.offset;
 		expect_id(&func_name);
-		v = make_var(func_name, type, position);
+		v = make_var(func_name, type, id_offset);
 		head = v;
 		nparams = nparams + 1;
 
@@ -280,8 +322,9 @@ void parse_funcdef(void)
 			expect(TOK_COMMA);
 			parse_type(&type);
 
+			id_offset = token.offset;
 			expect_id(&func_name);
-			v->next = make_var(func_name, type, position);
+			v->next = make_var(func_name, type, id_offset);
 			v = v->next;
 
 			nparams = nparams + 1;
@@ -308,7 +351,7 @@ void parse_funcdef(void)
 	Variable *var;
 	v = head;
 	for (i = 0; i < nparams; i++) {
-		var = make_var(v->id, params[i], position);
+		var = make_var(v->id, params[i], v->offset);
 		idprop = make_idprop(var->type, get_variables_width(), 0, NULL);
 		insert_name(var->id, idprop);
 		v = v->next;
@@ -366,25 +409,28 @@ void parse_vardef(void)
 	ValType type;
 	Variable *v;
 	IDprop *prop;
-	char *vname;
+	Symbol vname;
+	size_t id_offset;
 	parse_type(&type);
+	id_offset = token.offset;
 	expect_id(&vname);
-	v = make_var(vname, type, position);
+	v = make_var(vname, type, id_offset);
 	prop = make_idprop(v->type, get_variables_width(), 0, NULL);
 	if (find_name(vname, &prop) == FALSE) {
 		insert_name(vname, prop);
 	} else {
-		abort_c(ERR_MULTIPLE_DEFINITION, vname);
+		abort_c(ERR_MULTIPLE_DEFINITION, symbol_name(vname));
 	}
 	while (token.type == TOK_COMMA) {
 		expect(TOK_COMMA);
+		id_offset = token.offset;
 		expect_id(&vname);
-		v = make_var(vname, type, position);
+		v = make_var(vname, type, id_offset);
 		prop = make_idprop(v->type, get_variables_width(), 0, NULL);
 		if (find_name(vname, &prop) == FALSE) {
 			insert_name(vname, prop);
 		} else {
-			abort_c(ERR_MULTIPLE_DEFINITION, vname);
+			abort_c(ERR_MULTIPLE_DEFINITION, symbol_name(vname));
 		}
 	}
 	
@@ -458,13 +504,13 @@ void parse_if(void)
 	ValType type;
 	expect(TOK_IF);
 	parse_expr(&type);
-	check_types(type, TYPE_BOOLEAN, &position, "for 'if' guard");
+	check_types(type, TYPE_BOOLEAN, NULL, "for 'if' guard");
 	expect(TOK_THEN);
 	parse_statements();
 	while (token.type == TOK_ELSIF) {
 		expect(TOK_ELSIF);
 		parse_expr(&type);
-		check_types(type, TYPE_BOOLEAN, &position, "for 'elsif' guard");
+		check_types(type, TYPE_BOOLEAN, NULL, "for 'elsif' guard");
 		expect(TOK_THEN);
 		parse_statements();
 	}
@@ -481,14 +527,15 @@ void parse_name(void)
 	DBG_start("<name>");
 	ValType type;
 	IDprop *prop;
-	char *name;
+	Symbol name;
+	SourcePos pos;
 	expect_id(&name);
 	int offset = 0;
 	if (find_name(name, &prop) == TRUE) {
 		type = prop->type;
 		offset = prop->offset;
 	} else {
-		abort_c(ERR_UNKNOWN_IDENTIFIER, name);
+		abort_c(ERR_UNKNOWN_IDENTIFIER, symbol_name(name));
 	}
 	
 	if (token.type == TOK_LPAR) {
@@ -504,8 +551,8 @@ void parse_name(void)
 			} else if (token.type == TOK_ARRAY) {
 				expect(TOK_ARRAY);
 				parse_simple(&type);
-				check_types(type, TYPE_INTEGER, &position,
-							"for array size of '%s'", name);
+				check_types(type, TYPE_INTEGER, NULL,
+							"for array size of '%s'", symbol_name(name));
 			} else {
 				abort_c(ERR_ARRAY_ALLOCATION_OR_EXPRESSION_EXPECTED,
 						token.type);
@@ -537,8 +584,8 @@ void parse_name(void)
 		} else if (token.type == TOK_ARRAY) {
 			expect(TOK_ARRAY);
 			parse_simple(&type);
-			check_types(type, TYPE_INTEGER, &position, "for array size of '%s'",
-						name);
+			check_types(type, TYPE_INTEGER, NULL, "for array size of '%s'",
+						symbol_name(name));
 		} else {
 			abort_c(ERR_ARRAY_ALLOCATION_OR_EXPRESSION_EXPECTED, token.type);
 		}
@@ -554,11 +601,13 @@ void parse_name(void)
 		} else if (token.type == TOK_ARRAY) {
 			expect(TOK_ARRAY);
 			parse_simple(&type);
-			check_types(type, TYPE_INTEGER, &position, "for array size of '%s'",
-						name);
+			check_types(type, TYPE_INTEGER, NULL, "for array size of '%s'",
+						symbol_name(name));
 		} else {
-			position.col = position.col - 1;
-			abort_c(ERR_ARRAY_ALLOCATION_OR_EXPRESSION_EXPECTED, token.type);
+			pos = get_position();
+			pos.col--;
+			abort_cp(&pos, ERR_ARRAY_ALLOCATION_OR_EXPRESSION_EXPECTED,
+					token.type);
 		}
 		/*gen_2(JVM_ISTORE, offset);*/
 	} else {
@@ -571,7 +620,7 @@ void parse_name(void)
 void parse_read(void)
 {
 	DBG_start("<read>");
-	char *read_name;
+	Symbol read_name;
 	int offset = 0;
 	ValType type;
 	IDprop *prop;
@@ -597,7 +646,7 @@ void parse_while(void)
 	ValType type;
 	expect(TOK_WHILE);
 	parse_expr(&type);
-	check_types(type, TYPE_BOOLEAN, &position, "for 'while' guard");
+	check_types(type, TYPE_BOOLEAN, NULL, "for 'while' guard");
 	expect(TOK_DO);
 	parse_statements();
 	expect(TOK_END);
@@ -610,13 +659,13 @@ void parse_write(void)
 	ValType type;
 	expect(TOK_WRITE);
 	if (token.type == TOK_STR) {
-		gen_print_string(token.string);
+		gen_print_string(get_string(&token));
 		expect(TOK_STR);
 		if (token.type == TOK_AMPERSAND) {
 			while (token.type == TOK_AMPERSAND) {
 				expect(TOK_AMPERSAND);
 				if (token.type == TOK_STR) {
-					gen_print_string(token.string);
+					gen_print_string(get_string(&token));
 					expect(TOK_STR);
 				} else if (STARTS_EXPR(token.type)) {
 					parse_expr(&type);
@@ -638,7 +687,7 @@ void parse_write(void)
 			while (token.type == TOK_AMPERSAND) {
 				expect(TOK_AMPERSAND);
 				if (token.type == TOK_STR) {
-					gen_print_string(token.string);
+					gen_print_string(get_string(&token));
 					expect(TOK_STR);
 				} else if (STARTS_EXPR(token.type)) {
 					parse_expr(&type);
@@ -652,21 +701,22 @@ void parse_write(void)
 	DBG_end("</write>");
 }
 
-void parse_index(char *id)
+void parse_index(Symbol id)
 {
 	DBG_start("<index>");
 	ValType type;
 	expect(TOK_LBRACK);
 	parse_simple(&type);
-	check_types(type, TYPE_INTEGER, &position, "for array index of '%s'", id);
+	check_types(type, TYPE_INTEGER, NULL, "for array index of '%s'",
+				symbol_name(id));
 	expect(TOK_RBRACK);
 	DBG_end("</index>");
 }
 
-void parse_arglist(char *id, IDprop *prop)
+void parse_arglist(Symbol id, IDprop *prop)
 {
 	DBG_start("<arglist>");
-	id = "";
+	(void) id;
 	relop = 0;
 	ValType type;
 	expect(TOK_LPAR);
@@ -675,11 +725,11 @@ void parse_arglist(char *id, IDprop *prop)
 	}
 	if (STARTS_EXPR(token.type)) {
 		parse_expr(&type);
-		check_types(type, prop->type, &position);
+		check_types(type, prop->type, NULL);
 		while (token.type == TOK_COMMA) {
 			expect(TOK_COMMA);
 			parse_expr(&type);
-			check_types(type, prop->type, &position);
+			check_types(type, prop->type, NULL);
 		}
 	}
 	expect(TOK_RPAR);
@@ -699,17 +749,17 @@ void parse_simple(ValType *type)
 		if (token.type == TOK_PLUS) {
 			expect(token.type);		
 			parse_term(&t1);
-			check_types(t1, *type, &position);
+			check_types(t1, *type, NULL);
 			gen_1(JVM_IADD);
 		} else if (token.type == TOK_MINUS) {
 			expect(token.type);
 			parse_term(&t1);
-			check_types(t1, *type, &position);
+			check_types(t1, *type, NULL);
 			gen_1(JVM_ISUB);
 		} else if (token.type == TOK_OR) {
 			expect(token.type);
 			parse_term(&t1);
-			check_types(t1, *type, &position);
+			check_types(t1, *type, NULL);
 			gen_1(JVM_IOR);
 		}
 	}
@@ -725,22 +775,22 @@ void parse_term(ValType *type)
 		if (token.type == TOK_MUL) {
 			expect(token.type);
 			parse_factor(&t1);
-			check_types(t1, *type, &position);
+			check_types(t1, *type, NULL);
 			gen_1(JVM_IMUL);
 		} else if (token.type == TOK_DIV) {
 			expect(token.type);
 			parse_factor(&t1);
-			check_types(t1, *type, &position);
+			check_types(t1, *type, NULL);
 			gen_1(JVM_IDIV);
 		} else if (token.type == TOK_MOD) {
 			expect(token.type);
 			parse_factor(&t1);
-			check_types(t1, *type, &position);
+			check_types(t1, *type, NULL);
 			gen_1(JVM_IREM);
 		} else if (token.type == TOK_AND) {
 			expect(token.type);
 			parse_factor(&t1);
-			check_types(t1, *type, &position);
+			check_types(t1, *type, NULL);
 			gen_1(JVM_IAND);
 		}
 	}
@@ -749,7 +799,7 @@ void parse_term(ValType *type)
 
 void parse_factor(ValType *type)
 {
-	char *factor_name = NULL;
+	Symbol factor_name = NO_SYMBOL;
 	DBG_start("<factor>");
 	ValType t1;
 	IDprop *prop = NULL;
@@ -766,7 +816,7 @@ void parse_factor(ValType *type)
 				gen_2(JVM_ILOAD, offset);
 			}
 		} else {
-			abort_c(ERR_UNKNOWN_IDENTIFIER, factor_name);
+			abort_c(ERR_UNKNOWN_IDENTIFIER, symbol_name(factor_name));
 		}
 		if (token.type == TOK_LBRACK) {
 			parse_index(factor_name);
@@ -793,7 +843,7 @@ void parse_factor(ValType *type)
 			case TOK_NOT:
 				expect(TOK_NOT);
 				parse_factor(&t1);
-				check_types(t1, *type, &position);
+				check_types(t1, *type, NULL);
 				gen_2(JVM_IXOR, 1);
 				break;
 			case TOK_TRUE:
@@ -822,34 +872,34 @@ void parse_expr(ValType *type)
 		if (token.type == TOK_EQ) {
 			expect(token.type);
 			parse_simple(&t1);
-			check_types(*type, t1, &position);
+			check_types(*type, t1, NULL);
 			gen_1(JVM_IF_ICMPEQ);
 			/**type = TYPE_BOOLEAN;*/
 		} else if (token.type == TOK_NE) {
 			expect(token.type);
 			parse_simple(&t1);
-			check_types(*type, t1, &position);
+			check_types(*type, t1, NULL);
 			gen_1(JVM_IF_ICMPNE);
 			/**type = TYPE_BOOLEAN;*/
 		} else if (token.type == TOK_GE) {
 			expect(token.type);
 			parse_simple(&t1);
-			check_types(t1, *type, &position);
+			check_types(t1, *type, NULL);
 			gen_1(JVM_IF_ICMPGE);
 		} else if (token.type == TOK_GT) {
 			expect(token.type);
 			parse_simple(&t1);
-			check_types(t1, *type, &position);
+			check_types(t1, *type, NULL);
 			gen_1(JVM_IF_ICMPGT);
 		} else if (token.type == TOK_LE) {
 			expect(token.type);
 			parse_simple(&t1);
-			check_types(t1, *type, &position);
+			check_types(t1, *type, NULL);
 			gen_1(JVM_IF_ICMPLE);
 		} else if (token.type == TOK_LT) {
 			expect(token.type);
 			parse_simple(&t1);
-			check_types(t1, *type, &position);
+			check_types(t1, *type, NULL);
 			gen_1(JVM_IF_ICMPLT);
 		}
 	}
@@ -881,9 +931,7 @@ void check_types(ValType found, ValType expected, SourcePos *pos, ...)
 		s = va_arg(ap, char *);
 		vsnprintf(buf, MAX_MESSAGE_LENGTH, s, ap);
 		va_end(ap);
-		if (pos != NULL) {
-			position = *pos;
-		}
+		position = (pos != NULL ? *pos : get_position());
 		leprintf("incompatible types (expected %s, found %s) %s",
 				 get_valtype_string(expected), get_valtype_string(found), buf);
 	}
@@ -899,10 +947,10 @@ void expect(TokenType type)
 	}
 }
 
-void expect_id(char **id)
+void expect_id(Symbol *id)
 {
 	if (token.type == TOK_ID) {
-		*id = strdup(token.lexeme);
+		*id = token.symbol;
 		get_token(&token);
 	} else {
 		abort_c(ERR_EXPECT, TOK_ID);
@@ -926,14 +974,14 @@ IDprop *make_idprop(ValType type, unsigned int offset, unsigned int nparams,
 	return ip;
 }
 
-Variable *make_var(char *id, ValType type, SourcePos pos)
+Variable *make_var(Symbol id, ValType type, size_t offset)
 {
 	Variable *vp;
 
 	vp = emalloc(sizeof(Variable));
 	vp->id = id;
 	vp->type = type;
-	vp->pos = pos;
+	vp->offset = offset;
 	vp->next = NULL;
 
 	return vp;
@@ -967,9 +1015,7 @@ void _abort_compile(SourcePos *posp, Error err, va_list args)
 	char expstr[MAX_MESSAGE_LENGTH], *s /*, *t*/;
 	int tok;
 
-	if (posp) {
-		position = *posp;
-	}
+	position = (posp ? *posp : get_position());
 
 	snprintf(expstr, MAX_MESSAGE_LENGTH, "expected %%s, but found %s",
 			 get_token_string(token.type));
@@ -1106,7 +1152,8 @@ void debug_info(const char *fmt, ...)
 	vsprintf(buf_ptr, fmt, ap);
 
 	buf_ptr += strlen(buf_ptr);
-	snprintf(buf_ptr, MAX_MESSAGE_LENGTH, " in line %d.\n", position.line);
+	snprintf(buf_ptr, MAX_MESSAGE_LENGTH, " in line %d.\n",
+			 get_position().line);
 	fflush(stdout);
 	fputs(buf, stdout);
 	fflush(NULL);
@@ -0,0 +1,468 @@
+/**
+ * @file    swisstable.c
+ * @brief   A generic hash table, with open addressing over groups of slots
+ *          that are probed sixteen at a time.
+ *
+ * This is a third implementation of hashtable.h, after the Swiss tables of
+ * Abseil.  Besides its keys and values, the table keeps one control byte per
+ * slot: either EMPTY, DELETED, or the low seven bits of the hash code of the
+ * entry in the slot.  The slots fall into groups of sixteen, and a search
+ * compares the control bytes of a whole group against the seven bits of the
+ * hash code it is looking for at once, with a single SSE2 comparison on x86.
+ * Only the slots whose bytes match have their keys compared, which for a hit is
+ * nearly always just the one, and a group with an empty slot ends the search,
+ * which for a miss is nearly always the first.
+ *
+ * The number of slots is a power of two, and the remaining bits of the hash
+ * code choose the first group of the probe sequence.  Since the hash functions
+ * of the callers need not mix their bits, as the identity on symbols does not,
+ * the table mixes the hash code itself before using it.
+ *
+ * A deleted entry leaves a DELETED slot behind, which a search passes over but
+ * an insertion may take, unless its group has an empty slot: then no search
+ * ever went past the group, and the slot can simply be emptied.
+ */
+
+#include "hashtable.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+	&& defined(__SSE2__)
+#define HAVE_SSE2_PROBE
+#include <emmintrin.h>
+#endif
+
+#define INITIAL_SIZE      16
+#define PRINT_BUFFER_SIZE 1024
+
+/* the number of slots in a group, which is the width of an SSE2 register */
+#define GROUP_SIZE 16
+
+/* an open-addressed table cannot be full, so the load factor is capped here */
+#define MAX_LOADFACTOR 0.875f
+
+/* the control bytes of free slots have their top bit set, and those of used
+ * slots have it clear */
+#define EMPTY   0x80
+#define DELETED 0xfe
+#define IS_USED(c) (((c) & 0x80) == 0)
+
+/* the bits of a (mixed) hash code kept in the control byte, and the rest */
+#define H1(h) ((h) >> 7)
+#define H2(h) ((unsigned char) ((h) & 0x7f))
+
+/** a slot of the table */
+typedef struct {
+	void *key;
+	void *value;
+} Slot;
+
+/** a hash table container */
+struct hashtab {
+	/** the control bytes: EMPTY, DELETED, or H2 of the hash code      */
+	unsigned char *ctrl;
+	/** the keys and values of the slots                               */
+	Slot *slots;
+	/** the mixed hash codes of the slots, kept for growing the table  */
+	unsigned int *hashes;
+	/** the current size of the underlying table, a power of two       */
+	unsigned int size;
+	/** the current number of entries                                  */
+	unsigned int num_entries;
+	/** the current number of DELETED slots                            */
+	unsigned int num_deleted;
+	/** the number of used and DELETED slots at which to rehash        */
+	unsigned int max_entries;
+	/** the maximum load factor before the underlying table is resized */
+	float max_loadfactor;
+	/** a pointer to the hash function                                 */
+	unsigned int (*hash)(void *, unsigned int);
+	/** a pointer to the comparison function                           */
+	int (*cmp)(void *, void *);
+	/** the counters of the operations, if HASH_TABLE_STATS is defined */
+	HTstats counters;
+};
+
+/* --- function prototypes -------------------------------------------------- */
+
+static Boolean talloc(HashTab *ht, unsigned int size);
+static int rehash(HashTab *ht, unsigned int size);
+static unsigned int mix(unsigned int h);
+static unsigned int find_slot(HashTab *ht, void *key, unsigned int h);
+static void place(HashTab *ht, unsigned int h, void *key, void *value);
+static unsigned int match(const unsigned char *group, unsigned char b);
+static unsigned int match_free(const unsigned char *group);
+static unsigned int first_slot(unsigned int mask);
+
+/* --- hash table interface ------------------------------------------------- */
+
+HashTab *ht_init(float loadfactor, unsigned int (*hash)(void *, unsigned int),
+				 int (*cmp)(void *, void *))
+{
+	HashTab *ht;
+
+	if ((ht = malloc(sizeof(HashTab))) == NULL) {
+		return NULL;
+	}
+	ht->max_loadfactor = (loadfactor > 0.0f && loadfactor < MAX_LOADFACTOR
+			? loadfactor : MAX_LOADFACTOR);
+	if (!talloc(ht, INITIAL_SIZE)) {
+		free(ht);
+		return NULL;
+	}
+	ht->num_entries = 0;
+	ht->hash = hash;
+	ht->cmp = cmp;
+	memset(&ht->counters, 0, sizeof(HTstats));
+
+	return ht;
+}
+
+int ht_insert(HashTab *ht, void *key, void *value)
+{
+	unsigned int h, size;
+
+	h = mix(ht->hash(key, UINT_MAX));
+	if (find_slot(ht, key, h) != ht->size) {
+		return HASH_TABLE_KEY_VALUE_PAIR_EXISTS;
+	}
+	/* a table with many DELETED slots is cleaned up rather than grown; if the
+	 * table cannot be rehashed, it fills up beyond the load factor, but one
+	 * slot is always left empty, so that every search ends */
+	if (ht->num_entries + ht->num_deleted >= ht->max_entries) {
+		size = (ht->num_deleted > ht->max_entries / 4 ? ht->size
+				: 2 * ht->size);
+		/* twice the largest size is zero */
+		if ((size == 0 || rehash(ht, size) != EXIT_SUCCESS)
+				&& ht->num_entries + ht->num_deleted + 1 >= ht->size) {
+			return HASH_TABLE_NO_SPACE_FOR_NODE;
+		}
+	}
+
+	place(ht, h, key, value);
+	ht->num_entries++;
+
+	return EXIT_SUCCESS;
+}
+
+Boolean ht_search(HashTab *ht, void *key, void **value)
+{
+	unsigned int i = find_slot(ht, key, mix(ht->hash(key, UINT_MAX)));
+
+	if (i == ht->size) {
+		return FALSE;
+	}
+	*value = ht->slots[i].value;
+
+	return TRUE;
+}
+
+Boolean ht_delete(HashTab *ht, void *key, void (*freekey)(void *k),
+				  void (*freeval)(void *v))
+{
+	unsigned int i = find_slot(ht, key, mix(ht->hash(key, UINT_MAX)));
+
+	if (i == ht->size) {
+		return FALSE;
+	}
+	if (freekey) {
+		freekey(ht->slots[i].key);
+	}
+	if (freeval) {
+		freeval(ht->slots[i].value);
+	}
+	if (match(ht->ctrl + i / GROUP_SIZE * GROUP_SIZE, EMPTY) != 0) {
+		ht->ctrl[i] = EMPTY;
+	} else {
+		ht->ctrl[i] = DELETED;
+		ht->num_deleted++;
+	}
+	ht->num_entries--;
+
+	return TRUE;
+}
+
+int ht_reserve(HashTab *ht, unsigned int n)
+{
+	unsigned int size;
+
+	for (size = ht->size; size <= UINT_MAX / 2
+			&& (unsigned int) (ht->max_loadfactor * size) < n; size *= 2)
+		;
+	if ((unsigned int) (ht->max_loadfactor * size) < n) {
+		return HASH_TABLE_NO_SPACE_FOR_NODE;
+	}
+
+	return (size > ht->size ? rehash(ht, size) : EXIT_SUCCESS);
+}
+
+void ht_iter_init(HashTab *ht, HTiter *it)
+{
+	(void) ht;
+	it->index = 0;
+	it->entry = NULL;
+}
+
+Boolean ht_iter_next(HashTab *ht, HTiter *it, void **key, void **value)
+{
+	while (it->index < ht->size && !IS_USED(ht->ctrl[it->index])) {
+		it->index++;
+	}
+	if (it->index == ht->size) {
+		return FALSE;
+	}
+	if (key) {
+		*key = ht->slots[it->index].key;
+	}
+	if (value) {
+		*value = ht->slots[it->index].value;
+	}
+	it->index++;
+
+	return TRUE;
+}
+
+void ht_foreach(HashTab *ht, void (*visit)(void *k, void *v, void *arg),
+				void *arg)
+{
+	unsigned int i;
+
+	for (i = 0; i < ht->size; i++) {
+		if (IS_USED(ht->ctrl[i])) {
+			visit(ht->slots[i].key, ht->slots[i].value, arg);
+		}
+	}
+}
+
+Boolean ht_free(HashTab *ht, void (*freekey)(void *k), void (*freeval)(void *v))
+{
+	unsigned int i;
+
+	for (i = 0; (freekey || freeval) && i < ht->size; i++) {
+		if (IS_USED(ht->ctrl[i])) {
+			if (freekey) {
+				freekey(ht->slots[i].key);
+			}
+			if (freeval) {
+				freeval(ht->slots[i].value);
+			}
+		}
+	}
+	free(ht->ctrl);
+	free(ht->slots);
+	free(ht->hashes);
+	free(ht);
+
+	return EXIT_SUCCESS;
+}
+
+void ht_print(HashTab *ht, void (*keyval2str)(void *k, void *v, char *b))
+{
+	unsigned int i;
+	char buffer[PRINT_BUFFER_SIZE];
+
+	for (i = 0; i < ht->size; i++) {
+		printf("bucket[%2i]", i);
+		if (IS_USED(ht->ctrl[i])) {
+			keyval2str(ht->slots[i].key, ht->slots[i].value, buffer);
+			printf(" --> %s (0x%02x)", buffer, ht->ctrl[i]);
+		}
+		printf(" --> NULL\n");
+	}
+}
+
+/* The chain of an entry is counted in groups, since a search examines all the
+ * slots of a group at once. */
+void ht_stats(HashTab *ht, HTstats *stats)
+{
+	unsigned int num_groups = ht->size / GROUP_SIZE, i, g, home, step;
+
+	*stats = ht->counters;
+	stats->num_entries = ht->num_entries;
+	stats->size = ht->size;
+	for (i = 0; i < ht->size; i++) {
+		if (IS_USED(ht->ctrl[i])) {
+			home = H1(ht->hashes[i]) & (num_groups - 1);
+			for (g = home, step = 1; g != i / GROUP_SIZE;
+					g = (g + step++) & (num_groups - 1))
+				;
+			ht_add_chain(stats, step);
+		}
+	}
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+/* Allocates empty slots for a table of the specified size, a power of two no
+ * smaller than a group, and returns whether it could. */
+static Boolean talloc(HashTab *ht, unsigned int size)
+{
+	ht->size = size;
+	ht->max_entries = (unsigned int) (ht->max_loadfactor * size);
+	ht->num_deleted = 0;
+	ht->ctrl = malloc(size);
+	ht->slots = malloc(size * sizeof(Slot));
+	ht->hashes = malloc(size * sizeof(unsigned int));
+	if (ht->ctrl == NULL || ht->slots == NULL || ht->hashes == NULL) {
+		free(ht->ctrl);
+		free(ht->slots);
+		free(ht->hashes);
+		return FALSE;
+	}
+	memset(ht->ctrl, EMPTY, size);
+
+	return TRUE;
+}
+
+/* Moves the entries to a table of the specified size, which drops the DELETED
+ * slots.  The hash codes are kept, so neither the hash nor the comparison
+ * function is called. */
+static int rehash(HashTab *ht, unsigned int size)
+{
+	unsigned char *ctrl = ht->ctrl;
+	Slot *slots = ht->slots;
+	unsigned int *hashes = ht->hashes, old_size = ht->size;
+	unsigned int max_entries = ht->max_entries, num_deleted = ht->num_deleted;
+	unsigned int i;
+
+	if (!talloc(ht, size)) {
+		/* leave the table as it was */
+		ht->ctrl = ctrl;
+		ht->slots = slots;
+		ht->hashes = hashes;
+		ht->size = old_size;
+		ht->max_entries = max_entries;
+		ht->num_deleted = num_deleted;
+		return HASH_TABLE_NO_SPACE_FOR_NODE;
+	}
+
+	HT_COUNT(ht->counters, rehash_time, -ht_clock());
+	for (i = 0; i < old_size; i++) {
+		if (IS_USED(ctrl[i])) {
+			place(ht, hashes[i], slots[i].key, slots[i].value);
+		}
+	}
+	free(ctrl);
+	free(slots);
+	free(hashes);
+	HT_COUNT(ht->counters, rehashes, 1);
+	HT_COUNT(ht->counters, rehash_time, ht_clock());
+
+	return EXIT_SUCCESS;
+}
+
+/* Spreads every bit of the hash code over all of them, so that the low seven
+ * bits and the group bits above them both vary with the key. */
+static unsigned int mix(unsigned int h)
+{
+	h ^= h >> 16;
+	h *= 0x45d9f3bu;
+	h ^= h >> 16;
+
+	return h;
+}
+
+/* Returns the slot of the key with the specified mixed hash code, or the size
+ * of the table if there is none.  The groups are probed in triangular steps,
+ * which visit every group of a power-of-two table before repeating one. */
+static unsigned int find_slot(HashTab *ht, void *key, unsigned int h)
+{
+	unsigned int num_groups = ht->size / GROUP_SIZE, g, step, mask, i;
+	const unsigned char *group;
+
+	HT_COUNT(ht->counters, lookups, 1);
+	for (g = H1(h) & (num_groups - 1), step = 1; ;
+			g = (g + step++) & (num_groups - 1)) {
+		group = ht->ctrl + g * GROUP_SIZE;
+		for (mask = match(group, H2(h)); mask != 0; mask &= mask - 1) {
+			HT_COUNT(ht->counters, comparisons, 1);
+			i = g * GROUP_SIZE + first_slot(mask);
+			if (ht->cmp(key, ht->slots[i].key) == 0) {
+				HT_COUNT(ht->counters, hits, 1);
+				return i;
+			}
+		}
+		if (match(group, EMPTY) != 0) {
+			HT_COUNT(ht->counters, misses, 1);
+			return ht->size;
+		}
+	}
+}
+
+/* Places an entry, known not to be in the table, in the first empty or DELETED
+ * slot of its probe sequence, which a search for it reaches before it stops. */
+static void place(HashTab *ht, unsigned int h, void *key, void *value)
+{
+	unsigned int num_groups = ht->size / GROUP_SIZE, g, step, mask, i;
+
+	for (g = H1(h) & (num_groups - 1), step = 1;
+			(mask = match_free(ht->ctrl + g * GROUP_SIZE)) == 0;
+			g = (g + step++) & (num_groups - 1))
+		;
+	i = g * GROUP_SIZE + first_slot(mask);
+	if (ht->ctrl[i] == DELETED) {
+		ht->num_deleted--;
+	}
+	ht->ctrl[i] = H2(h);
+	ht->slots[i].key = key;
+	ht->slots[i].value = value;
+	ht->hashes[i] = h;
+}
+
+/* Returns a mask with bit i set for each control byte i of the group that
+ * equals the specified byte. */
+static unsigned int match(const unsigned char *group, unsigned char b)
+{
+#ifdef HAVE_SSE2_PROBE
+	__m128i ctrl = _mm_loadu_si128((const __m128i *) group);
+
+	return (unsigned int) _mm_movemask_epi8(
+			_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char) b)));
+#else
+	unsigned int mask = 0, i;
+
+	for (i = 0; i < GROUP_SIZE; i++) {
+		mask |= (unsigned int) (group[i] == b) << i;
+	}
+
+	return mask;
+#endif
+}
+
+/* Returns a mask with bit i set for each slot i of the group that is free,
+ * that is, EMPTY or DELETED; these are the bytes with the top bit set. */
+static unsigned int match_free(const unsigned char *group)
+{
+#ifdef HAVE_SSE2_PROBE
+	return (unsigned int) _mm_movemask_epi8(
+			_mm_loadu_si128((const __m128i *) group));
+#else
+	unsigned int mask = 0, i;
+
+	for (i = 0; i < GROUP_SIZE; i++) {
+		mask |= (unsigned int) !IS_USED(group[i]) << i;
+	}
+
+	return mask;
+#endif
+}
+
+/* the index of the lowest set bit of a nonzero mask */
+static unsigned int first_slot(unsigned int mask)
+{
+#ifdef __GNUC__
+	return (unsigned int) __builtin_ctz(mask);
+#else
+	unsigned int i;
+
+	for (i = 0; (mask & 1) == 0; i++) {
+		mask >>= 1;
+	}
+
+	return i;
+#endif
+}
@@ -13,14 +13,74 @@
 #include <string.h>
 
 #include "boolean.h"
+#include "conctable.h"
 #include "error.h"
-#include "hashtable.h"
+#include "intern.h"
 #include "token.h"
+#include "typedtable.h"
 #include "valtypes.h"
 
+/* --- helper macros -------------------------------------------------------- */
+
+/* symbols are handed out densely, so they spread well over a power-of-two size
+ * as they are */
+#define SYMBOL_HASH(sym)   (sym)
+#define SAME_SYMBOL(a, b)  ((a) == (b))
+
+/* the symbols of subroutines are stored in the concurrent table as keys */
+#define SYMBOL_KEY(sym) ((void *) (size_t) (sym))
+#define KEY_SYMBOL(key) ((Symbol) (size_t) (key))
+
+/* the initial number of scopes and undo entries that there is room for */
+#define INITIAL_SCOPES 8
+#define INITIAL_UNDO   64
+
+/* --- type definitions ----------------------------------------------------- */
+
+/** the innermost binding of a name */
+typedef struct {
+	IDprop       *prop;   /*<< the properties; NULL for no binding        */
+	unsigned int  depth;  /*<< the depth of the scope that declared it    */
+} Binding;
+
+/** a binding that a declaration shadowed, to be put back when its scope ends */
+typedef struct {
+	Symbol   id;        /*<< the name that was declared                     */
+	Binding  shadowed;  /*<< the binding it shadowed, if any                */
+} UndoEntry;
+
+/** an open scope */
+typedef struct {
+	unsigned int  mark;    /*<< the length of the undo log when it opened  */
+	unsigned int  offset;  /*<< the current offset when it opened          */
+	unsigned int  frame;   /*<< the frame depth when it opened             */
+} Scope;
+
+/* the table maps each name to its innermost binding, through calls that the
+ * compiler can inline */
+DEFINE_TYPED_TABLE(SymTab, symtab, Symbol, Binding, SYMBOL_HASH, SAME_SYMBOL)
+
 /* --- global static variables ---------------------------------------------- */
 
-static HashTab *table, *saved_table;
+/* The variables of all scopes share one table.  A declaration records the
+ * binding it shadows in the undo log, and closing a scope pops the log back to
+ * the mark that the scope pushed, so that every lookup of a variable is a
+ * single probe of the table. */
+static SymTab *table;
+static UndoEntry *undo_log;
+static unsigned int undo_len, undo_max;
+static Scope *scopes;
+static unsigned int depth, max_scopes;
+/* the depth of the innermost subroutine scope, or 0 in the global scope; a
+ * variable from outside it is hidden */
+static unsigned int frame;
+/* The global function scope: the subroutines, which other threads may look up
+ * while the main thread defines more.  The table owns their properties, and
+ * they never enter the undo log, so closing a scope never frees them. */
+static ConcTab *callables;
+/* whether this thread initialised the symbol table, and so may see the table
+ * of variables, which is not synchronised */
+static _Thread_local Boolean owner;
 /* TODO: Nothing here, but note that the next variable keeps a running count of
  * the number of variables in the current symbol table.  It will be necessary
  * during code generation to compute the size of the local variable array of a
@@ -30,89 +90,125 @@ static unsigned int curr_offset;
 
 /* --- function prototypes -------------------------------------------------- */
 
-static void valstr(void *key, void *p, char *str);
-/*static void freeprop(void *p);*/
-static unsigned int shift_hash(void *key, unsigned int size);
-static int key_strcmp(void *val1, void *val2);
+static void push_scope(Boolean subroutine);
+static void pop_scope(void);
+static inline Boolean is_visible(const Binding *b);
+static void print_entry(Symbol id, Binding b, void *arg);
+static void print_callable(void *key, void *value, void *arg);
+static void valstr(Symbol id, IDprop *p, char *str);
+static void freebinding(Binding b);
+static unsigned int symbol_hash(void *key, unsigned int size);
+static int symbol_cmp(void *val1, void *val2);
 
 /* --- symbol table interface ----------------------------------------------- */
 
 void init_symbol_table(void)
 {
-	saved_table = NULL;
-	if ((table = ht_init(0.75f, shift_hash, key_strcmp)) == NULL) {
+	if ((table = symtab_init(0.75f)) == NULL) {
 		eprintf("Symbol table could not be initialised");
 	}
+	undo_max = INITIAL_UNDO;
+	undo_log = emalloc(undo_max * sizeof(UndoEntry));
+	undo_len = 0;
+	max_scopes = INITIAL_SCOPES;
+	scopes = emalloc(max_scopes * sizeof(Scope));
+	depth = frame = 0;
+	callables = ct_init(0.75f, symbol_hash, symbol_cmp);
+	owner = TRUE;
 	curr_offset = 1;
 }
 
-Boolean open_subroutine(char *id, IDprop *prop)
+Boolean open_subroutine(Symbol id, IDprop *prop)
 {
-	if (insert_name(id, prop) == EXIT_SUCCESS) {
-		saved_table = table;
-		/*saved_table = ht_init(0.75f, shift_hash, key_strcmp);*/
-		table = ht_init(0.75f, shift_hash, key_strcmp);
-		curr_offset = 1;
-		return TRUE;
-	} else {
+	Binding *b;
+
+	/* a subroutine goes into the global function scope, not the table of
+	 * variables, but its name must be free in the current scope as well */
+	b = symtab_find(table, id);
+	if ((b != NULL && b->depth == depth)
+			|| ct_insert(callables, SYMBOL_KEY(id), prop) != EXIT_SUCCESS) {
 		return FALSE;
 	}
+	push_scope(TRUE);
 
-	/* TODO:
-	 * - Insert the subroutine name into the global symbol table; return TRUE or
-	 *   FALSE, depending on whether or not the insertion succeeded.
-	 * - Save the global symbol table to saved_table, initialise a new hash
-	 *   table for the subroutine, and reset the current offset.
-	 */
+	return TRUE;
 }
 
 void close_subroutine(void)
 {
-	/*ht_free(saved_table, free, free);
-	saved_table = table;*/
-	ht_free(table, free, free);
-	table = saved_table;
-	/*table = saved_table;*/
-	/* TODO: Release the subroutine table, and reactivate the global table. */
+	/* pop the frame scope that open_subroutine pushed */
+	pop_scope();
 }
 
-Boolean insert_name(char *id, IDprop *prop)
+void open_scope(void)
 {
-	if (!find_name(id, &prop)) {
-		if (ht_insert(table, id, prop) == EXIT_SUCCESS) {
-			if (IS_VARIABLE(prop->type)) {
-				curr_offset++;
-			}
-			return TRUE;
-		} else {
-			return FALSE;
+	push_scope(FALSE);
+}
+
+void close_scope(void)
+{
+	pop_scope();
+}
+
+Boolean insert_name(Symbol id, IDprop *prop)
+{
+	Binding *b, binding;
+	void *value;
+
+	/* a name may shadow any variable but one of the current scope, but never a
+	 * subroutine */
+	b = symtab_find(table, id);
+	if ((b != NULL && b->depth == depth)
+			|| ct_search(callables, SYMBOL_KEY(id), &value)) {
+		return FALSE;
+	}
+
+	binding.prop = prop;
+	binding.depth = depth;
+	/* the global scope is never closed, so it needs no undo entries */
+	if (depth > 0) {
+		if (undo_len == undo_max) {
+			undo_max *= 2;
+			undo_log = erealloc(undo_log, undo_max * sizeof(UndoEntry));
+		}
+		undo_log[undo_len].id = id;
+		undo_log[undo_len].shadowed.prop = NULL;
+		if (b != NULL) {
+			undo_log[undo_len].shadowed = *b;
+		}
+		undo_len++;
+	}
+	if (b != NULL) {
+		*b = binding;
+	} else if (symtab_insert(table, id, binding) != EXIT_SUCCESS) {
+		if (depth > 0) {
+			undo_len--;
 		}
-	} else {
 		return FALSE;
 	}
-	/* TODO: Insert the properties of the identifier into the hash table, and
-	 * remember to increment the current offset pointer if the identifier is a
-	 * variable.
-	 *
-	 * VERY IMPORTANT: Remember to read the documentation of this function in
-	 * the header file.
-	 */
+
+	if (IS_VARIABLE(prop->type)) {
+		curr_offset++;
+	}
+	return TRUE;
 }
 
-Boolean find_name(char *id, IDprop **prop)
+Boolean find_name(Symbol id, IDprop **prop)
 {
-	Boolean found;
+	Binding *b;
+	void *value;
 
 	/* TODO: Nothing, unless you want to.*/
-	found = ht_search(table, id, (void **)prop);
-	if (!found && saved_table) {
-		found = ht_search(saved_table, id, (void **)prop);
-		if (found && !IS_CALLABLE_TYPE((*prop)->type)) {
-			found = FALSE;
-		}
+	if (owner && (b = symtab_find(table, id)) != NULL && is_visible(b)) {
+		*prop = b->prop;
+		return TRUE;
+	}
+	if (ct_search(callables, SYMBOL_KEY(id), &value)) {
+		*prop = value;
+		return TRUE;
 	}
 
-	return found;
+	return FALSE;
 }
 
 int get_variables_width(void) 
@@ -122,21 +218,106 @@ int get_variables_width(void)
 
 void release_symbol_table(void)
 {
-	/* TODO: Free the underlying structures of the symbol table. */
-	ht_free(table, free, free);
+	while (depth > 0) {
+		pop_scope();
+	}
+	symtab_free(table, freebinding);
+	free(undo_log);
+	free(scopes);
+	ct_free(callables, NULL, free);
 }
 
 void print_symbol_table(void) 
 { 
-	ht_print(table, valstr); 
+	symtab_foreach(table, print_entry, NULL);
+	if (frame == 0) {
+		ct_foreach(callables, print_callable, NULL);
+	}
+}
+
+void print_symbol_table_stats(void)
+{
+	HTstats stats;
+
+	symtab_stats(table, &stats);
+	ht_print_stats(stderr, "symbol table", &stats);
 }
 
 /* --- utility functions ---------------------------------------------------- */
 
-static void valstr(void *key, void *p, char *str)
+/* Opens a scope at the next depth.  A subroutine scope also starts a new frame,
+ * with its own offsets, out of which the variables of the enclosing scopes are
+ * hidden. */
+static void push_scope(Boolean subroutine)
+{
+	if (depth == max_scopes) {
+		max_scopes *= 2;
+		scopes = erealloc(scopes, max_scopes * sizeof(Scope));
+	}
+	scopes[depth].mark = undo_len;
+	scopes[depth].offset = curr_offset;
+	scopes[depth].frame = frame;
+	depth++;
+	if (subroutine) {
+		frame = depth;
+		curr_offset = 1;
+	}
+}
+
+/* Closes the innermost scope: each of its declarations is undone, latest
+ * first, by putting back the binding it shadowed, or removing the name if it
+ * shadowed none.  The names of identifiers belong to the interning pool. */
+static void pop_scope(void)
 {
-	char *keystr = (char *)key;
-	IDprop *idpp = (IDprop *)p;
+	UndoEntry *u;
+	Binding *b;
+
+	assert(depth > 0);
+	depth--;
+	while (undo_len > scopes[depth].mark) {
+		u = &undo_log[--undo_len];
+		b = symtab_find(table, u->id);
+		free(b->prop);
+		if (u->shadowed.prop != NULL) {
+			*b = u->shadowed;
+		} else {
+			symtab_delete(table, u->id, NULL);
+		}
+	}
+	curr_offset = scopes[depth].offset;
+	frame = scopes[depth].frame;
+}
+
+static inline Boolean is_visible(const Binding *b)
+{
+	return (b->depth >= frame);
+}
+
+static void print_entry(Symbol id, Binding b, void *arg)
+{
+	char buffer[1024];
+
+	/* the variables that the current frame cannot see are left out */
+	(void) arg;
+	if (is_visible(&b)) {
+		valstr(id, b.prop, buffer);
+		printf("%s\n", buffer);
+	}
+}
+
+static void print_callable(void *key, void *value, void *arg)
+{
+	char buffer[1024];
+
+	(void) arg;
+	valstr(KEY_SYMBOL(key), value, buffer);
+	printf("%s\n", buffer);
+}
+
+static void valstr(Symbol id, IDprop *p, char *str)
+{
+	const char *keystr = symbol_name(id);
+	IDprop *idpp = p;
 
 	/* TODO: Nothing, but this shoud give you an idea of how to look at the
 	 * contents of the symbol table.
@@ -147,24 +328,21 @@ static void valstr(void *key, void *p, char *str)
 			get_valtype_string(idpp->type));
 }
 
-static unsigned int shift_hash(void *key, unsigned int size)
+static void freebinding(Binding b)
 {
-	char *keystr = (char *)key;
-	unsigned int i, hash, length;
-
-	hash = 0;
-	length = strlen(keystr);
-	for (i = 0; i < length; i++) {
-		hash = (hash << 5) | (hash >> 27);
-		hash += keystr[i];
-	}
+	free(b.prop);
+}
 
-	return (hash % size);
+static unsigned int symbol_hash(void *key, unsigned int size)
+{
+	return KEY_SYMBOL(key) % size;
 }
 
-static int key_strcmp(void *val1, void *val2)
+static int symbol_cmp(void *val1, void *val2)
 {
-	return strcmp((char *)val1, (char *)val2);
+	Symbol s1 = KEY_SYMBOL(val1), s2 = KEY_SYMBOL(val2);
+
+	return (s1 > s2) - (s1 < s2);
 }
 
 /* TODO: Here you should add your own utility functions, in particular, for
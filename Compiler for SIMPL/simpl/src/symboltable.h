@@ -9,6 +9,7 @@
 #define SYMBOLTABLE_H
 
 #include "boolean.h"
+#include "intern.h"
 #include "token.h"
 #include "valtypes.h"
 
@@ -26,9 +27,11 @@ void init_symbol_table(void);
 
 /**
  * Opens a new function or procedure (subroutine) context by (1) inserting the
- * subroutine name and properties into the global symbol table, (2) preserving
- * the global symbol table for later re-use, and (3) initialising a new local
- * symbol table for the subroutine as current symbol table.
+ * subroutine name and properties into the global function scope, unless the
+ * name is already taken, and (2) opening a new scope for the subroutine, with
+ * offsets of its own, in which the variables of the enclosing scopes are
+ * hidden.  Any thread may look the subroutine up as soon as this function
+ * returns.
  *
  * @param[in]   id
  *     the identifier of the new function or procedure
@@ -37,34 +40,52 @@ void init_symbol_table(void);
  * @return      <code>TRUE</code> if the local subroutine context was set up
  *              successfully, or <code>FALSE</code> otherwise
  */
-Boolean open_subroutine(char *id, IDprop *prop);
+Boolean open_subroutine(Symbol id, IDprop *prop);
 
 /**
- * Closes the current subroutine context by (1) releasing memory resources
- * associated with the current local symbol table, and (2) setting the preserved
- * global symbol table as the current symbol table.
+ * Closes the current subroutine context by closing its scope, as
+ * <code>close_scope</code> does, and restoring the offset of the enclosing
+ * scope.  The subroutine itself stays in the global function scope.
  */
 void close_subroutine(void);
 
+/**
+ * Opens a nested block scope, in which every identifier of the enclosing scope
+ * remains visible until a declaration shadows it.  Offsets carry on from those
+ * of the enclosing scope.
+ */
+void open_scope(void);
+
+/**
+ * Closes the innermost scope, by releasing the properties of every variable
+ * declared in it, and bringing back every binding that they shadowed.
+ */
+void close_scope(void);
+
 /**
  * Inserts the specified identifier with the specified properties into the
- * current symbol table.  This function "steals" the <code>id</code> and
- * <code>prop</code> pointers, and assumes responsibility for their
- * deallocation.
+ * current scope, where it shadows any variable of the same name in an enclosing
+ * scope until the current scope is closed; a subroutine cannot be shadowed.
+ * This function "steals" the <code>prop</code> pointer, and assumes
+ * responsibility for its deallocation; the name of the identifier belongs to
+ * the interning pool.
  *
  * @param[in]   id
  *     the identifier to insert
  * @param[in]   prop
  *     the properties to be associated with the new identifier
  * @return      <code>FALSE</code> if the identifier is already in the current
- *              symbol table, or if there was not enough space for a new entry,
- *              or <code>TRUE</code> otherwise
+ *              scope, or is a subroutine, or if there was not enough space for
+ *              a new entry, or <code>TRUE</code> otherwise
  */
-Boolean insert_name(char *id, IDprop *prop);
+Boolean insert_name(Symbol id, IDprop *prop);
 
 /**
  * Retrieves the properties associated with the specified identifier from the
- * current symbol table.
+ * current symbol table, or from the global function scope.  Only the thread
+ * that initialised the symbol table sees the variables; any other thread may
+ * call this function at any time, but only finds subroutines, and so can
+ * resolve calls while the main thread goes on defining subroutines.
  *
  * @param[in]   id
  *     the identifier to look up in the current symbol table
@@ -74,7 +95,7 @@ Boolean insert_name(char *id, IDprop *prop);
  * @return      <code>TRUE</code> if the identifier exists in the current symbol
  *              table, or <code>FALSE</code> otherwise
  */
-Boolean find_name(char *id, IDprop **prop);
+Boolean find_name(Symbol id, IDprop **prop);
 
 /**
  * Returns the number of the identifiers stored in the current symbol table.
@@ -91,4 +112,11 @@ void release_symbol_table(void);
  */
 void print_symbol_table(void);
 
+/**
+ * Prints statistics on the table of variables, which holds the bindings of
+ * every open scope, to the standard error stream.  The operations are only
+ * counted if the symbol table is compiled with HASH_TABLE_STATS defined.
+ */
+void print_symbol_table_stats(void);
+
 #endif /* SYMBOLTABLE_H */
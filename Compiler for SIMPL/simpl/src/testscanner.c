@@ -9,6 +9,7 @@
 #include <stdlib.h>
 
 #include "error.h"
+#include "intern.h"
 #include "scanner.h"
 #include "token.h"
 
@@ -23,9 +24,8 @@ int main(int argc, char *argv[])
 	Token token;
 	FILE *in_file;
 
-	/* set up program name and token */
+	/* set up program name */
 	setprogname(argv[0]);
-	token.string = NULL;
 
 	/* check command-line argument and open file */
 	if (argc != 2) {
@@ -39,6 +39,7 @@ int main(int argc, char *argv[])
 	}
 
 	/* initialise scanner */
+	init_intern();
 	init_scanner(in_file);
 
 	/* iterate over tokens in the input file */
@@ -48,6 +49,11 @@ int main(int argc, char *argv[])
 		get_token(&token);
 	}
 
+	/* release the scanner and source file */
+	release_scanner();
+	release_intern();
+	fclose(in_file);
+
 	/* free names */
 	freeprogname();
 	freesrcname();
@@ -62,14 +68,15 @@ void print_token(Token *token)
 {
 	switch (token->type) {
 		case TOK_ID:
-			printf("Identifier: '%s'\n", token->lexeme);
+			printf("Identifier: '%.*s'\n", (int) token->length,
+					get_lexeme(token));
 			break;
 		case TOK_NUM:
 			printf("Number: %d\n", token->value);
 			break;
 		case TOK_STR:
-			printf("String: \"%s\"\n", token->string);
-			free(token->string);
+			printf("String: \"%.*s\"\n", (int) token->length,
+					get_lexeme(token));
 			break;
 		default:
 			printf("%s\n", get_token_string(token->type));
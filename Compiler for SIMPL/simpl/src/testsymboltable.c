@@ -9,16 +9,19 @@
 #include <stdlib.h>
 #include <string.h>
 #include "boolean.h"
+#include "intern.h"
 #include "symboltable.h"
 
 #define BUFFER_SIZE 1024
 
 int main()
 {
-	char buffer[BUFFER_SIZE], *id;
+	char buffer[BUFFER_SIZE];
+	Symbol id;
 	Boolean main_is_active;
 	IDprop *propts;
 
+	init_intern();
 	init_symbol_table();
 	main_is_active = TRUE;
 
@@ -45,7 +48,7 @@ int main()
 				continue;
 			}
 
-			id = strdup(buffer);
+			id = intern(buffer, strlen(buffer));
 			propts = malloc(sizeof(IDprop));
 			propts->type = TYPE_CALLABLE | TYPE_INTEGER;
 			propts->nparams = 0;
@@ -55,7 +58,6 @@ int main()
 				main_is_active = FALSE;
 			} else {
 				printf("Subroutine already exists ... not added.\n");
-				free(id);
 				free(propts);
 			}
 
@@ -76,7 +78,7 @@ int main()
 		} else if (strcmp(buffer, "insert") == 0) {
 
 			scanf("%s", buffer);
-			id = strdup(buffer);
+			id = intern(buffer, strlen(buffer));
 			propts = malloc(sizeof(IDprop));
 			propts->type = TYPE_INTEGER;
 			propts->nparams = 0;
@@ -84,14 +86,13 @@ int main()
 
 			if (!insert_name(id, propts)) {
 				printf("Identifier already exists ... not added.\n");
-				free(id);
 				free(propts);
 			}
 
 		} else if (strcmp(buffer, "find") == 0) {
 
 			scanf("%s", buffer);
-			if (find_name(buffer, &propts)) {
+			if (find_name(intern(buffer, strlen(buffer)), &propts)) {
 				printf("\"%s\" at offset %i.\n", buffer,
 						propts->offset);
 			} else {
@@ -113,6 +114,7 @@ int main()
 
 	printf("Goodbye!\n");
 	release_symbol_table();
+	release_intern();
 
 	return EXIT_SUCCESS;
 }
@@ -9,6 +9,9 @@
 #ifndef TOKEN_H
 #define TOKEN_H
 
+#include <stddef.h>
+#include "intern.h"
+
 /** the maximum length of an identifier */
 #define MAX_ID_LENGTH 32
 
@@ -79,12 +82,18 @@ typedef enum {
 
 } TokenType;
 
-/** the token data type */
+/**
+ * The token data type.  A token does not carry a copy of its lexeme; instead,
+ * it records where the lexeme lies in the source, and the scanner hands out the
+ * characters on request.  For a string, the lexeme is the text between the
+ * quotes.  An identifier also carries its interned symbol.
+ */
 typedef struct {
-	TokenType  type;                     /**< type of the token            */
-	int        value;                    /**< numeric value (for integers) */
-	char       lexeme[MAX_ID_LENGTH+1];  /**< lexeme (for identifiers)     */
-	char      *string;                   /**< string (for write)           */
+	TokenType  type;    /**< type of the token                        */
+	int        value;   /**< numeric value (for integers)             */
+	Symbol     symbol;  /**< interned symbol (for identifiers)        */
+	size_t     offset;  /**< byte offset of the lexeme in the source  */
+	size_t     length;  /**< length of the lexeme in bytes            */
 } Token;
 
 /**
@@ -0,0 +1,102 @@
+/**
+ * @file    tokenring.c
+ * @brief   A single-producer, single-consumer ring buffer of tokens.
+ *
+ * The producer stores its tail with release semantics after filling the slots
+ * below it, and the consumer loads it with acquire semantics before reading
+ * them; the head goes the other way.  A side that finds the ring full (or
+ * empty) first spins for a little while, since the other side is usually about
+ * to catch up, and then yields the processor.
+ */
+
+#include "tokenring.h"
+
+#include <sched.h>
+
+#define SPIN_LIMIT 128
+
+/* --- function prototypes -------------------------------------------------- */
+
+static void backoff(unsigned int *spins);
+
+/* --- token ring interface ------------------------------------------------- */
+
+void init_token_ring(TokenRing *ring)
+{
+	atomic_init(&ring->tail, 0);
+	atomic_init(&ring->head, 0);
+	atomic_init(&ring->closed, FALSE);
+	ring->prod_tail = ring->prod_head = 0;
+	ring->cons_head = ring->cons_tail = 0;
+}
+
+TokenSlot *ring_reserve(TokenRing *ring)
+{
+	unsigned int spins = 0;
+
+	if (ring->prod_tail - ring->prod_head == RING_SIZE) {
+		/* the consumer cannot catch up on slots it has not been shown */
+		ring_flush(ring);
+		while ((ring->prod_head = atomic_load_explicit(&ring->head,
+						memory_order_acquire)) + RING_SIZE == ring->prod_tail) {
+			if (atomic_load_explicit(&ring->closed, memory_order_relaxed)) {
+				return NULL;
+			}
+			backoff(&spins);
+		}
+	}
+
+	return &ring->slots[ring->prod_tail % RING_SIZE];
+}
+
+void ring_push(TokenRing *ring)
+{
+	if (++ring->prod_tail % RING_BATCH == 0) {
+		ring_flush(ring);
+	}
+}
+
+void ring_flush(TokenRing *ring)
+{
+	atomic_store_explicit(&ring->tail, ring->prod_tail, memory_order_release);
+}
+
+void ring_pop(TokenRing *ring, TokenSlot *slot)
+{
+	unsigned int spins = 0;
+
+	if (ring->cons_head == ring->cons_tail) {
+		/* let the producer have the slots consumed so far before waiting */
+		atomic_store_explicit(&ring->head, ring->cons_head,
+				memory_order_release);
+		while ((ring->cons_tail = atomic_load_explicit(&ring->tail,
+						memory_order_acquire)) == ring->cons_head) {
+			backoff(&spins);
+		}
+	}
+
+	*slot = ring->slots[ring->cons_head % RING_SIZE];
+	if (++ring->cons_head % RING_BATCH == 0) {
+		atomic_store_explicit(&ring->head, ring->cons_head,
+				memory_order_release);
+	}
+}
+
+void ring_close(TokenRing *ring)
+{
+	atomic_store_explicit(&ring->closed, TRUE, memory_order_relaxed);
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+static void backoff(unsigned int *spins)
+{
+	if (*spins < SPIN_LIMIT) {
+		(*spins)++;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+		__builtin_ia32_pause();
+#endif
+	} else {
+		sched_yield();
+	}
+}
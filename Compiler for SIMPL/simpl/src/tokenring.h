@@ -0,0 +1,110 @@
+/**
+ * @file    tokenring.h
+ * @brief   A single-producer, single-consumer ring buffer of tokens, through
+ *          which the scanner thread feeds the parser.
+ *
+ * The ring is lock-free: the producer and the consumer each own one index, and
+ * only read the other's.  To keep the two threads from fighting over the cache
+ * lines that hold the indices, each side publishes its index only once per
+ * batch of tokens, or when it is about to wait for the other side.
+ */
+
+#ifndef TOKENRING_H
+#define TOKENRING_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include "boolean.h"
+#include "token.h"
+
+/** the number of slots in a ring; a power of two */
+#define RING_SIZE  4096
+
+/** the number of slots that either side handles before publishing its index */
+#define RING_BATCH 64
+
+/** a token, as handed from the scanner thread to the parser */
+typedef struct {
+	Token    token;   /**< the token                                   */
+	size_t   start;   /**< the offset at which the token starts        */
+	size_t   end;     /**< the offset of the character after the token */
+	Boolean  failed;  /**< whether scanning failed, instead, at start  */
+} TokenSlot;
+
+/**
+ * The ring buffer.  The indices count slots from the start, and are reduced
+ * modulo <code>RING_SIZE</code> only to address a slot.  Each side's fields
+ * start a cache line of their own.
+ */
+typedef struct {
+	TokenSlot     slots[RING_SIZE];    /**< the slots                       */
+	_Alignas(64)
+	atomic_size_t tail;                /**< the tail, as published          */
+	size_t        prod_tail;           /**< the producer's (private) tail   */
+	size_t        prod_head;           /**< the head, as last seen          */
+	_Alignas(64)
+	atomic_size_t head;                /**< the head, as published          */
+	size_t        cons_head;           /**< the consumer's (private) head   */
+	size_t        cons_tail;           /**< the tail, as last seen          */
+	atomic_bool   closed;              /**< whether the consumer has quit   */
+} TokenRing;
+
+/**
+ * Initialises the specified ring as empty.
+ *
+ * @param[in]   ring
+ *     the ring to initialise
+ */
+void init_token_ring(TokenRing *ring);
+
+/**
+ * Returns the next free slot of the specified ring, for the producer to fill,
+ * waiting until the consumer has made room if necessary.  The slot is handed to
+ * the consumer by a later call to <code>ring_push</code>.
+ *
+ * @param[in]   ring
+ *     the ring
+ * @return      the slot to fill, or <code>NULL</code> if the consumer has
+ *              closed the ring
+ */
+TokenSlot *ring_reserve(TokenRing *ring);
+
+/**
+ * Adds the slot last returned by <code>ring_reserve</code> to the specified
+ * ring.  The slot only becomes visible to the consumer at the end of a batch,
+ * or when <code>ring_flush</code> is called.
+ *
+ * @param[in]   ring
+ *     the ring
+ */
+void ring_push(TokenRing *ring);
+
+/**
+ * Makes all the slots pushed so far visible to the consumer.
+ *
+ * @param[in]   ring
+ *     the ring
+ */
+void ring_flush(TokenRing *ring);
+
+/**
+ * Removes the oldest slot from the specified ring, waiting until the producer
+ * has published one if necessary.
+ *
+ * @param[in]   ring
+ *     the ring
+ * @param[out]  slot
+ *     the slot into which to copy the one removed
+ */
+void ring_pop(TokenRing *ring, TokenSlot *slot);
+
+/**
+ * Tells the producer that no more slots will be removed from the specified
+ * ring, so that it stops rather than waits for room.
+ *
+ * @param[in]   ring
+ *     the ring
+ */
+void ring_close(TokenRing *ring);
+
+#endif /* TOKENRING_H */
@@ -0,0 +1,307 @@
+/**
+ * @file    typedtable.h
+ * @brief   A hash table template, instantiated for given key and value types.
+ *
+ * <code>HashTab</code> stores <code>void *</code> keys and values, and calls
+ * its hash and comparison functions through pointers, so none of those calls
+ * can be inlined.  This header generates, instead, a table for particular key
+ * and value types, with particular hash and equality functions, out of static
+ * inline functions that the compiler can specialise at every call.
+ *
+ * For example,
+ *
+ *     DEFINE_TYPED_TABLE(SymTab, symtab, Symbol, IDprop *, hash, same)
+ *
+ * defines the types <code>SymTab</code> and <code>SymTabSlot</code>, and the
+ * functions <code>symtab_init</code>, <code>symtab_insert</code>,
+ * <code>symtab_search</code>, <code>symtab_delete</code>,
+ * <code>symtab_reserve</code>, <code>symtab_foreach</code>,
+ * <code>symtab_free</code>, <code>symtab_print</code>, and
+ * <code>symtab_stats</code>, which work as their <code>ht_</code> counterparts
+ * in hashtable.h do.  Besides, <code>symtab_find</code> returns a pointer to
+ * the value of a key, through which the value may be replaced, or
+ * <code>NULL</code> if the key is not in the table; the pointer holds until
+ * the table is next changed.  The hash function takes a key and returns its
+ * full hash code, which the table reduces to its own size; the equality
+ * function takes two keys and returns nonzero if they are equal.  Either may
+ * be a macro.
+ *
+ * The table is open-addressed and probed linearly, and its size is a power of
+ * two.  Each slot keeps the hash code of its key, with the top bit set to mark
+ * the slot as used, so that a probe compares keys only if the hash codes match,
+ * and growing the table does not call the hash function again.  A deletion
+ * moves the entries after the deleted one back, where their probes allow, so
+ * that no slot is ever marked as deleted.
+ */
+
+#ifndef TYPEDTABLE_H
+#define TYPEDTABLE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "boolean.h"
+#include "hashtable.h"
+
+/** the initial number of slots of a table; a power of two */
+#define TYPED_TABLE_INITIAL_SIZE 16
+
+/** the highest load factor that a table accepts */
+#define TYPED_TABLE_MAX_LOADFACTOR 0.9f
+
+/** the bit that marks a slot as used, in the hash code that the slot keeps */
+#define TYPED_TABLE_USED 0x80000000u
+
+/** the size of the buffer handed to the function that formats an entry */
+#define TYPED_TABLE_PRINT_BUFFER_SIZE 1024
+
+/**
+ * Defines a hash table type, with its slot type and functions.
+ *
+ * @param[in]   Name
+ *     the name of the table type; the slot type is this name followed by
+ *     <code>Slot</code>
+ * @param[in]   prefix
+ *     the prefix of the names of the functions
+ * @param[in]   Key
+ *     the type of the keys
+ * @param[in]   Value
+ *     the type of the values
+ * @param[in]   hash_fn
+ *     the hash function, from a key to an <code>unsigned int</code>
+ * @param[in]   equal_fn
+ *     the equality function, from two keys to nonzero if they are equal
+ */
+#define DEFINE_TYPED_TABLE(Name, prefix, Key, Value, hash_fn, equal_fn)       \
+                                                                              \
+typedef struct {                                                              \
+	unsigned int hash;                                                        \
+	Key          key;                                                         \
+	Value        value;                                                       \
+} Name##Slot;                                                                 \
+                                                                              \
+typedef struct {                                                              \
+	Name##Slot   *slots;                                                      \
+	unsigned int  mask;                                                       \
+	unsigned int  num_entries;                                                \
+	unsigned int  max_entries;                                                \
+	float         max_loadfactor;                                             \
+	HTstats       counters;                                                   \
+} Name;                                                                       \
+                                                                              \
+static inline Boolean prefix##_alloc_slots(Name *t, unsigned int size)        \
+{                                                                             \
+	if ((t->slots = calloc(size, sizeof(Name##Slot))) == NULL) {              \
+		return FALSE;                                                         \
+	}                                                                         \
+	t->mask = size - 1;                                                       \
+	t->max_entries = (unsigned int) (t->max_loadfactor * size);               \
+	return TRUE;                                                              \
+}                                                                             \
+                                                                              \
+static inline Name *prefix##_init(float loadfactor)                           \
+{                                                                             \
+	Name *t;                                                                  \
+                                                                              \
+	if ((t = malloc(sizeof(Name))) == NULL) {                                 \
+		return NULL;                                                          \
+	}                                                                         \
+	t->max_loadfactor = (loadfactor > 0.0f                                    \
+			&& loadfactor < TYPED_TABLE_MAX_LOADFACTOR                        \
+			? loadfactor : TYPED_TABLE_MAX_LOADFACTOR);                       \
+	if (!prefix##_alloc_slots(t, TYPED_TABLE_INITIAL_SIZE)) {                 \
+		free(t);                                                              \
+		return NULL;                                                          \
+	}                                                                         \
+	t->num_entries = 0;                                                       \
+	memset(&t->counters, 0, sizeof(HTstats));                                 \
+	return t;                                                                 \
+}                                                                             \
+                                                                              \
+static inline Value *prefix##_find(Name *t, Key key)                          \
+{                                                                             \
+	unsigned int h = (hash_fn(key)) | TYPED_TABLE_USED, i;                    \
+                                                                              \
+	HT_COUNT(t->counters, lookups, 1);                                        \
+	for (i = h & t->mask; t->slots[i].hash != 0; i = (i + 1) & t->mask) {     \
+		HT_COUNT(t->counters, comparisons, 1);                                \
+		if (t->slots[i].hash == h && (equal_fn(t->slots[i].key, key))) {      \
+			HT_COUNT(t->counters, hits, 1);                                   \
+			return &t->slots[i].value;                                        \
+		}                                                                     \
+	}                                                                         \
+	HT_COUNT(t->counters, misses, 1);                                         \
+	return NULL;                                                              \
+}                                                                             \
+                                                                              \
+static inline Boolean prefix##_search(Name *t, Key key, Value *value)         \
+{                                                                             \
+	Value *v = prefix##_find(t, key);                                         \
+                                                                              \
+	if (v == NULL) {                                                          \
+		return FALSE;                                                         \
+	}                                                                         \
+	*value = *v;                                                              \
+	return TRUE;                                                              \
+}                                                                             \
+                                                                              \
+static inline void prefix##_place(Name##Slot *slots, unsigned int mask,       \
+		const Name##Slot *slot)                                               \
+{                                                                             \
+	unsigned int i;                                                           \
+                                                                              \
+	for (i = slot->hash & mask; slots[i].hash != 0; i = (i + 1) & mask)       \
+		;                                                                     \
+	slots[i] = *slot;                                                         \
+}                                                                             \
+                                                                              \
+static inline Boolean prefix##_grow(Name *t)                                  \
+{                                                                             \
+	Name##Slot *old = t->slots;                                               \
+	unsigned int i, old_size = t->mask + 1;                                   \
+                                                                              \
+	if (old_size >= TYPED_TABLE_USED                                          \
+			|| !prefix##_alloc_slots(t, 2 * old_size)) {                      \
+		t->slots = old;                                                       \
+		return FALSE;                                                         \
+	}                                                                         \
+	HT_COUNT(t->counters, rehash_time, -ht_clock());                          \
+	for (i = 0; i < old_size; i++) {                                          \
+		if (old[i].hash != 0) {                                               \
+			prefix##_place(t->slots, t->mask, &old[i]);                       \
+		}                                                                     \
+	}                                                                         \
+	free(old);                                                                \
+	HT_COUNT(t->counters, rehashes, 1);                                       \
+	HT_COUNT(t->counters, rehash_time, ht_clock());                           \
+	return TRUE;                                                              \
+}                                                                             \
+                                                                              \
+static inline int prefix##_insert(Name *t, Key key, Value value)              \
+{                                                                             \
+	Name##Slot slot;                                                          \
+	unsigned int h = (hash_fn(key)) | TYPED_TABLE_USED, i;                    \
+                                                                              \
+	/* the probe for the key ends at the empty slot where it belongs */       \
+	HT_COUNT(t->counters, lookups, 1);                                        \
+	for (i = h & t->mask; t->slots[i].hash != 0; i = (i + 1) & t->mask) {     \
+		HT_COUNT(t->counters, comparisons, 1);                                \
+		if (t->slots[i].hash == h && (equal_fn(t->slots[i].key, key))) {      \
+			HT_COUNT(t->counters, hits, 1);                                   \
+			return HASH_TABLE_KEY_VALUE_PAIR_EXISTS;                          \
+		}                                                                     \
+	}                                                                         \
+	HT_COUNT(t->counters, misses, 1);                                         \
+	slot.hash = h;                                                            \
+	slot.key = key;                                                           \
+	slot.value = value;                                                       \
+	if (t->num_entries < t->max_entries) {                                    \
+		t->slots[i] = slot;                                                   \
+	} else if (prefix##_grow(t)) {                                            \
+		/* the slot that the probe ended at belonged to the old slots */      \
+		prefix##_place(t->slots, t->mask, &slot);                             \
+	} else if (t->num_entries < t->mask) {                                    \
+		/* if the table cannot grow, it fills up beyond the load factor */    \
+		t->slots[i] = slot;                                                   \
+	} else {                                                                  \
+		return HASH_TABLE_NO_SPACE_FOR_NODE;                                  \
+	}                                                                         \
+	t->num_entries++;                                                         \
+	return EXIT_SUCCESS;                                                      \
+}                                                                             \
+                                                                              \
+static inline Boolean prefix##_delete(Name *t, Key key,                       \
+		void (*freeval)(Value v))                                             \
+{                                                                             \
+	unsigned int h = (hash_fn(key)) | TYPED_TABLE_USED, i, j;                 \
+                                                                              \
+	for (i = h & t->mask; t->slots[i].hash != 0; i = (i + 1) & t->mask) {     \
+		if (t->slots[i].hash == h && (equal_fn(t->slots[i].key, key))) {      \
+			break;                                                            \
+		}                                                                     \
+	}                                                                         \
+	if (t->slots[i].hash == 0) {                                              \
+		return FALSE;                                                         \
+	}                                                                         \
+	if (freeval) {                                                            \
+		freeval(t->slots[i].value);                                           \
+	}                                                                         \
+	/* an entry moves into the hole if its home slot is not after the hole */ \
+	for (j = (i + 1) & t->mask; t->slots[j].hash != 0;                        \
+			j = (j + 1) & t->mask) {                                          \
+		if (((j - t->slots[j].hash) & t->mask) >= ((j - i) & t->mask)) {      \
+			t->slots[i] = t->slots[j];                                        \
+			i = j;                                                            \
+		}                                                                     \
+	}                                                                         \
+	t->slots[i].hash = 0;                                                     \
+	t->num_entries--;                                                         \
+	return TRUE;                                                              \
+}                                                                             \
+                                                                              \
+static inline int prefix##_reserve(Name *t, unsigned int n)                   \
+{                                                                             \
+	while (n > t->max_entries) {                                              \
+		if (!prefix##_grow(t)) {                                              \
+			return HASH_TABLE_NO_SPACE_FOR_NODE;                              \
+		}                                                                     \
+	}                                                                         \
+	return EXIT_SUCCESS;                                                      \
+}                                                                             \
+                                                                              \
+static inline void prefix##_foreach(Name *t,                                  \
+		void (*visit)(Key k, Value v, void *arg), void *arg)                  \
+{                                                                             \
+	unsigned int i;                                                           \
+                                                                              \
+	for (i = 0; i <= t->mask; i++) {                                          \
+		if (t->slots[i].hash != 0) {                                          \
+			visit(t->slots[i].key, t->slots[i].value, arg);                   \
+		}                                                                     \
+	}                                                                         \
+}                                                                             \
+                                                                              \
+static inline void prefix##_free(Name *t, void (*freeval)(Value v))           \
+{                                                                             \
+	unsigned int i;                                                           \
+                                                                              \
+	for (i = 0; freeval && i <= t->mask; i++) {                               \
+		if (t->slots[i].hash != 0) {                                          \
+			freeval(t->slots[i].value);                                       \
+		}                                                                     \
+	}                                                                         \
+	free(t->slots);                                                           \
+	free(t);                                                                  \
+}                                                                             \
+                                                                              \
+static inline void prefix##_print(const Name *t,                              \
+		void (*keyval2str)(Key k, Value v, char *b))                          \
+{                                                                             \
+	unsigned int i;                                                           \
+	char buffer[TYPED_TABLE_PRINT_BUFFER_SIZE];                               \
+                                                                              \
+	for (i = 0; i <= t->mask; i++) {                                          \
+		printf("bucket[%2u]", i);                                             \
+		if (t->slots[i].hash != 0) {                                          \
+			keyval2str(t->slots[i].key, t->slots[i].value, buffer);           \
+			printf(" --> %s", buffer);                                        \
+		}                                                                     \
+		printf(" --> NULL\n");                                                \
+	}                                                                         \
+}                                                                             \
+                                                                              \
+static inline void prefix##_stats(const Name *t, HTstats *stats)              \
+{                                                                             \
+	unsigned int i;                                                           \
+                                                                              \
+	*stats = t->counters;                                                     \
+	stats->num_entries = t->num_entries;                                      \
+	stats->size = t->mask + 1;                                                \
+	for (i = 0; i <= t->mask; i++) {                                          \
+		if (t->slots[i].hash != 0) {                                          \
+			ht_add_chain(stats, ((i - t->slots[i].hash) & t->mask) + 1);      \
+		}                                                                     \
+	}                                                                         \
+}
+
+#endif /* TYPEDTABLE_H */